@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bash_func.h"
+
+#define ARENA_BLOCK_SIZE 4096
+#define ARENA_ALIGNMENT 16
+
+
+// Function to allocate a new arena block with at least size bytes
+static struct ArenaBlock* createArenaBlock(size_t size) {
+    struct ArenaBlock* block = (struct ArenaBlock*)malloc(sizeof(struct ArenaBlock) + size);
+    if (block == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+
+    return block;
+}
+
+// Function to prepare an empty arena
+void initArena(struct Arena* arena) {
+    arena->head = createArenaBlock(ARENA_BLOCK_SIZE);
+    arena->total = ARENA_BLOCK_SIZE;
+}
+
+// Function to take size bytes from the arena; the memory lives until resetArena()
+void* arenaAlloc(struct Arena* arena, size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+    struct ArenaBlock* block = arena->head;
+    if (block->used + size > block->size) {
+        size_t blockSize = block->size * 2;
+        if (blockSize < size) {
+            blockSize = size;
+        }
+
+        block = createArenaBlock(blockSize);
+        block->next = arena->head;
+        arena->head = block;
+        arena->total += blockSize;
+    }
+
+    void* memory = block->data + block->used;
+    block->used += size;
+    return memory;
+}
+
+// Function to copy length bytes of str into the arena as a C string
+char* arenaStrndup(struct Arena* arena, const char* str, size_t length) {
+    char* copy = (char*)arenaAlloc(arena, length + 1);
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+// Function to release everything allocated for one command line
+void resetArena(struct Arena* arena) {
+    if (arena->head->next != NULL) {
+        // The line needed several blocks: replace them with one block of the same total size
+        size_t total = arena->total;
+        freeArena(arena);
+        arena->head = createArenaBlock(total);
+        arena->total = total;
+        return;
+    }
+
+    arena->head->used = 0;
+}
+
+// Function to free all arena blocks
+void freeArena(struct Arena* arena) {
+    struct ArenaBlock* current = arena->head;
+    struct ArenaBlock* next;
+
+    while (current != NULL) {
+        next = current->next;
+        free(current);
+        current = next;
+    }
+
+    arena->head = NULL;
+    arena->total = 0;
+}
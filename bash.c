@@ -3,139 +3,297 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <signal.h>
+#include <time.h>
 
 #include "bash_func.h"
 
 
-int main() {
-	struct Command* commands = NULL;
-	struct Job* jobList = NULL;
-	struct History* historyList = NULL;
-	
-	signal(SIGINT, SIG_IGN);
-	signal(SIGTSTP, SIG_IGN);
-	signal(SIGTERM, SIG_IGN);
-	signal(SIGQUIT, SIG_IGN);
-	signal(SIGTTOU, SIG_IGN);
-	signal(SIGTTIN, SIG_IGN);
+static int lastStatus = 0;     // Exit status of the last command line, the shell's own status
+static long lastDurationUs = 0; // Wall time of the last command line
+static long readStarted = 0;    // When reading the current line began (traceClock())
 
+
+// Function to get the microseconds since start (monotonic clock)
+static long elapsedUs(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000L + (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+// Function to run one input line, returns 1 when the shell should exit.
+// Everything built for the line comes from the arena, the caller resets it afterwards
+static int processLine(struct Arena* arena, char* input, struct Job** jobList, struct History** historyList) {
+    if (input[0] == '\0') { // If press Enter, skip and continue new iteration
+        return 0;
+    }
+
+    traceNextCommand();
+    tracePhase("read", readStarted, 0);
+    addToHistory(historyList, input);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    takeForegroundCpu(); // CPU of children reaped outside of this line is not counted
+
+    // Repeated lines skip tokenizing and parsing
+    size_t length = strlen(input);
+    struct Ast* ast = lookupParseCache(input, length);
+
+    if (ast == NULL) {
+        // Tokens are cut in place, so work on the arena's copy of the line
+        char* line = arenaStrndup(arena, input, length);
+
+        int tokenCount;
+        long phaseStart = traceClock();
+        struct Token* tokens = splitStringWithoutSpaces(arena, line, &tokenCount);
+        tracePhase("tokenize", phaseStart, 0);
+        if (tokenCount == 0) {
+            return 0;
+        }
+
+        phaseStart = traceClock();
+        ast = parseCommandsFromWords(arena, tokens, tokenCount);
+        tracePhase("parse", phaseStart, 0);
+        if (ast == NULL) {
+            lastStatus = 2; // syntax error
+            lastDurationUs = elapsedUs(&start);
+            finishHistoryEntry(*historyList, lastStatus, lastDurationUs, 0);
+            return 0;
+        }
+
+        ast = storeParseCache(input, length, ast);
+    }
+
+    fflush(stdout); // Children must not inherit unflushed output
+    lastStatus = executeCommand(ast, jobList, historyList);
+    lastDurationUs = elapsedUs(&start);
+    finishHistoryEntry(*historyList, lastStatus, lastDurationUs, takeForegroundCpu());
+
+    return exitRequested() != -1;
+}
+
+// Script mode: run every line of a buffer without prompt, returns 1 when 'exit' was found
+static int runScriptBuffer(char* data, size_t size, struct Job** jobList, struct History** historyList) {
+    struct Arena arena;
+    initArena(&arena);
+    int done = 0;
+    size_t offset = 0;
+
+    while (offset < size) {
+        readStarted = traceClock();
+        char* line = data + offset;
+        char* newline = memchr(line, '\n', size - offset);
+
+        if (newline == NULL) {
+            // Last line without '\n': the buffer may end on a page boundary, so copy it
+            size_t length = size - offset;
+            char* lastLine = (char*)malloc(length + 1);
+            if (lastLine == NULL) {
+                perror("Memory allocation");
+                exit(1);
+            }
+            memcpy(lastLine, line, length);
+            lastLine[length] = '\0';
+
+            reapChildren(jobList, 0);
+            done = processLine(&arena, lastLine, jobList, historyList);
+            free(lastLine);
+            break;
+        }
+
+        *newline = '\0';
+        offset = (size_t)(newline - data) + 1;
+
+        reapChildren(jobList, 0);
+        done = processLine(&arena, line, jobList, historyList);
+        resetArena(&arena);
+        if (done) {
+            break;
+        }
+    }
+
+    freeArena(&arena);
+    return done;
+}
+
+// Script mode: map the whole file and run it
+static int runScriptFile(const char* path, struct Job** jobList, struct History** historyList) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        perror(path);
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror(path);
+        close(fd);
+        return 1;
+    }
+
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    // Private writable mapping: lines are NUL-terminated in place, the file is untouched
+    char* data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+    runScriptBuffer(data, st.st_size, jobList, historyList);
+    munmap(data, st.st_size);
+
+    return 0;
+}
+
+// Non-interactive mode for piped stdin: no prompt, no getcwd
+static void runStream(struct Job** jobList, struct History** historyList) {
+    struct LineReader reader;
+    struct Arena arena;
+    initLineReader(&reader, STDIN_FILENO);
+    initArena(&arena);
+
+    size_t length;
+    char* input;
     while (1) {
-    	    updateJobList(&jobList);
-    	    pwd();
-	    
-	    char* input = characterInput();
-	    if (feof(stdin)) {
-	    	printf("CTRL+D handled\n");
-		free(input);
-	    	break;
-
-	    }
-	    
-	    if (input[0] == '\0') { // If press Enter, skip and continue new iteration
-	    	free(input);
-	    	continue;
-	    } else if (strcmp(input, "history") == 0) {
-	    	printHistory(historyList);
-	    	free(input);
-	    	continue;
-	    } else if (strcmp(input, "history -c") == 0) {
-	    	clearHistory(&historyList);
-	    	free(input);
-	    	continue;
-	    } else if (strcmp(input, "exit") == 0) {
-	    	free(input);
-	    	break;
-	    }
-	    
-	    addToHistory(&historyList, input);
-	
-	    int wordCount;
-	    char** words = splitStringWithoutSpaces(input, &wordCount);  
-            
-	    int firstOperatorFlag = 0;
-	    int secondOperatorFlag = 0;
-	    
-	    commands = parseCommandsFromWords(words, wordCount, &firstOperatorFlag, &secondOperatorFlag);
-	    
-	    
-	    if (strcmp(commands->words[0], "cd") == 0) {
-	    	if (wordCount == 1) {
-	    		cd(NULL);
-	   
-	    	} else cd(commands->words[1]);
-	    	
-	    } else if (strcmp(commands->words[0], "echo") == 0) {
-	    	echo(commands->words[1]);
-	    
-	    } else if (strcmp(commands->words[0], "help") == 0) {
-	    	help();
-	    
-	    } else if (strcmp(commands->words[0], "jobs") == 0) {
-	    	if (jobList != NULL) {
-	    		printJobs(jobList);
-	    	} else {
-	    		printf("No jobs\n");
-	    	}
-	    } else if (strcmp(commands->words[0], "fg") == 0) {
-	    	char* identifier = NULL;
-	    	if (commands->words[1] != NULL) {
-	    		identifier = commands->words[1];
-	    	}
-	    	
-	    	bringToForeground(&jobList, identifier);
-	    
-	    } else if (strcmp(commands->words[0], "bg") == 0) {
-	    	if (commands->words[1] == NULL) {
-	    		resumeInBackground(&jobList, NULL);
-	    	} else {
-	    		resumeInBackground(&jobList, commands->words[1]);
-	    	}
-	    } else if (strcmp(commands->words[0], "kill") == 0) {
-	    	char* identifier[2] = {commands->words[1], commands->words[2]};
-		killProcessByIdentifier(commands, &jobList, identifier);
-		
-		freeCommand(&commands);
-	    } else if (strcmp(commands->words[0], "wait") == 0) {
-	    	if (commands->words[1] != NULL) {
-	    		pid_t waitPid = atoi(commands->words[1]);
-				
-			waitProcess(&jobList, waitPid);
-		} else {
-			perror("Invalid wait command. Please provide a valid PID.");
-		}
-	    
-	    } else {
-	    	executeCommand(commands, &jobList, &historyList, firstOperatorFlag, secondOperatorFlag);
-	    }
-	    
-	    freeCommand(&commands);
-	    free(input);
-	    for (int i = 0; i < wordCount; i++) {
-	    	free(words[i]);
-	    }
-	   	
-	    free(words);
+        readStarted = traceClock();
+        input = readLine(&reader, &length);
+        if (input == NULL) {
+            break;
+        }
+        reapChildren(jobList, 0);
+
+        int done = processLine(&arena, input, jobList, historyList);
+        resetArena(&arena);
+        if (done) {
+            break;
+        }
     }
-    
-    while (historyList != NULL) {
-    	struct History* temp = historyList;
-    	historyList = historyList->next;
-     
-    	free(temp->command);
-    	free(temp);
+
+    freeArena(&arena);
+    freeLineReader(&reader);
+}
+
+// Function to show the prompt for the shell's current state
+static void showPrompt(struct Job* jobList) {
+    printPrompt(getJobCount(jobList), lastStatus, lastDurationUs);
+    fflush(stdout);
+}
+
+// Function to wait until the terminal has input; jobs that finish meanwhile are
+// reported right away and the prompt is shown again
+static void waitForInput(struct LineEditor* editor, struct Job** jobList) {
+    while (!keysPending(editor)) {
+        int notices = 0;
+        int ready = waitForEvents(jobList, 1, &notices);
+
+        if (notices > 0) {
+            showPrompt(*jobList);
+        }
+        if (ready != 0) {
+            return; // Input, or no event loop: just read
+        }
     }
-    
-    if (jobList != NULL) {
-    	clearJobs(&jobList);
+}
+
+// Interactive mode: prompt, edit a line, run it
+static void runInteractive(struct Job** jobList, struct History** historyList) {
+    struct LineEditor editor;
+    struct Arena arena;
+    initLineEditor(&editor, STDIN_FILENO);
+    initArena(&arena);
+
+    while (1) {
+        reapChildren(jobList, 0);
+        showPrompt(*jobList);
+
+        startEditing(&editor);
+        waitForInput(&editor, jobList);
+        readStarted = traceClock(); // Time to edit the line once keys came in
+
+        size_t length;
+        char* input = editLine(&editor, *historyList, &length);
+        stopEditing(&editor);
+        if (input == NULL) {
+            printf("CTRL+D handled\n");
+            break;
+
+        }
+
+        int done = processLine(&arena, input, jobList, historyList);
+        resetArena(&arena);
+        if (done) {
+            break;
+        }
     }
-    
-    if (commands != NULL && jobList != NULL) {
-    	freeCommand(&commands);
-    	clearJobs(&jobList);
+
+    freeArena(&arena);
+    freeLineEditor(&editor);
+}
+
+
+int main(int argc, char* argv[]) {
+    struct Job* jobList = NULL;
+    struct History* historyList = NULL;
+
+    int interactive = (argc == 1 && isatty(STDIN_FILENO));
+
+    if (interactive) {
+        signal(SIGINT, SIG_IGN);
+        signal(SIGTSTP, SIG_IGN);
+        signal(SIGTERM, SIG_IGN);
+        signal(SIGQUIT, SIG_IGN);
     }
+    signal(SIGTTOU, SIG_IGN);
+    signal(SIGTTIN, SIG_IGN);
+    initChildSignals();
+    initEventLoop();
+    initTracing();
+
+    if (argc >= 2 && strcmp(argv[1], "-c") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "bash: -c: option requires an argument\n");
+            return 2;
+        }
+
+        char* script = strdup(argv[2]);
+        if (script == NULL) {
+            perror("Memory allocation");
+            exit(1);
+        }
+        runScriptBuffer(script, strlen(script), &jobList, &historyList);
+        free(script);
+
+    } else if (argc >= 2) {
+        if (runScriptFile(argv[1], &jobList, &historyList) != 0) {
+            lastStatus = 127;
+        }
+
+    } else if (!interactive) {
+        runStream(&jobList, &historyList);
+
+    } else {
+        loadHistory(&historyList);
+        runInteractive(&jobList, &historyList);
+    }
+
+    if (jobList != NULL) {
+        clearJobs(&jobList);
+    }
+
     freeHistory(historyList);
+    clearParseCache();
+    clearCommandPaths();
 
-    return 0;
+    return (exitRequested() != -1) ? exitRequested() : lastStatus;
 }
@@ -5,638 +5,700 @@
 #include <sys/wait.h>
 #include <unistd.h>
 #include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
 
 #include "bash_func.h"
 
 
 // Parser Section 
-// Function for string input
-char* characterInput() {
-    int size = 10; // original size for string
-    int length = 0; // current string length
-    char* input = (char*)malloc(size * sizeof(char));
-    
-    if (input == NULL) {
+#define READER_BLOCK_SIZE 65536
+
+// Function to prepare a block reader for a file descriptor
+void initLineReader(struct LineReader* reader, int fd) {
+    reader->fd = fd;
+    reader->capacity = READER_BLOCK_SIZE;
+    reader->start = 0;
+    reader->scan = 0;
+    reader->end = 0;
+    reader->eof = 0;
+    reader->buffer = (char*)malloc(reader->capacity);
+
+    if (reader->buffer == NULL) {
         perror("Memory allocation");
         exit(1);
     }
-    
-    int c;
+}
+
+// Function to read the next line; the result points into the reader's buffer and
+// stays valid until the next call. Returns NULL at end of input
+char* readLine(struct LineReader* reader, size_t* length) {
     while (1) {
-        c = getchar();
-        
-        if (c == EOF) {
-       		return input;
+        char* newline = memchr(reader->buffer + reader->scan, '\n', reader->end - reader->scan);
+
+        if (newline != NULL) {
+            char* line = reader->buffer + reader->start;
+            *newline = '\0';
+            *length = (size_t)(newline - line);
+            reader->start = reader->scan = (size_t)(newline - reader->buffer) + 1;
+            return line;
         }
-	
+        reader->scan = reader->end;
 
-        if (c == '\n') {
-            break;
+        if (reader->eof) {
+            if (reader->start == reader->end) {
+                return NULL;
+            }
+
+            // Last line without '\n' (there is always room for the terminator)
+            char* line = reader->buffer + reader->start;
+            reader->buffer[reader->end] = '\0';
+            *length = reader->end - reader->start;
+            reader->start = reader->scan = reader->end;
+            return line;
         }
 
-        input[length++] = (char)c;
+        // Keep the partial line at the front of the buffer before the next block
+        if (reader->start > 0) {
+            memmove(reader->buffer, reader->buffer + reader->start, reader->end - reader->start);
+            reader->end -= reader->start;
+            reader->scan = reader->end;
+            reader->start = 0;
+        }
 
-        if (length >= size) {
-            size *= 2; // expand size of string
-            input = (char*)realloc(input, size * sizeof(char));
-            if (input == NULL) {
+        if (reader->end + 1 >= reader->capacity) {
+            reader->capacity *= 2; // line longer than the buffer
+            reader->buffer = (char*)realloc(reader->buffer, reader->capacity);
+            if (reader->buffer == NULL) {
                 perror("Memory overlocation");
                 exit(1);
             }
         }
+
+        ssize_t bytesRead = read(reader->fd, reader->buffer + reader->end, reader->capacity - 1 - reader->end);
+        if (bytesRead > 0) {
+            reader->end += bytesRead;
+        } else if (bytesRead == 0) {
+            reader->eof = 1;
+        } else if (errno != EINTR) {
+            perror("read");
+            reader->eof = 1;
+        }
     }
+}
 
-    input[length] = '\0';
-    return input;
+// Function to free the reader's buffer
+void freeLineReader(struct LineReader* reader) {
+    free(reader->buffer);
+    reader->buffer = NULL;
 }
 
-// Function for splitting a string and writing it to an array
-char** splitStringWithoutSpaces(char* str, int* wordCount) {
-    int wordBufferSize = 10;
-    *wordCount = 0;
-    char** words = NULL;
-    words = (char**)malloc(wordBufferSize * sizeof(char*));
-    
-    if (words == NULL) {
-        perror("Memory allocation");
-        exit(1);
+// FNV-1a hash of length bytes, shared by every hash table of the shell
+unsigned long hashBytes(const char* data, size_t length) {
+    unsigned long hash = 14695981039346656037UL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211UL;
     }
-    
-    for (int k = 0; k < wordBufferSize; k++) {
-    	words[k] = NULL;
-    }
-
-    int i = 0;
-    int start = -1;
-    int inWord = 0;
-
-    while (str[i] != '\0') {
-        if (str[i] == ' ' || str[i] == '\t' || str[i] == '\n') {
-            if (inWord) {
-                // Find the space and start new word if it is word yet
-                int length = i - start;
-                if (*wordCount >= wordBufferSize) {
-                    wordBufferSize *= 2;
-                    words = (char**)realloc(words, wordBufferSize * sizeof(char*));
-                    if (words == NULL) {
-                        perror("Memory overlocation");
-                        exit(1);
-                    }
-                }
-
-                words[(*wordCount)] = (char*)malloc(length + 1);
-                if (words[(*wordCount)] == NULL) {
-                    perror("Memory allocation");
-                    exit(1);
-                }
-                strncpy(words[(*wordCount)++], str + start, length);
-                words[*wordCount - 1][length] = '\0';
-
-                inWord = 0;
+    return hash;
+}
+
+// Operator text by token type
+static const char* operatorText[] = {"", "|", "&", "||", "&&", ";", ">", ">>", "<"};
+
+// Function to classify the operator at str, returns its token type and sets its length
+static int lexOperator(const char* str, int* length) {
+    *length = 1;
+
+    switch (str[0]) {
+        case '|':
+            if (str[1] == '|') {
+                *length = 2;
+                return TOKEN_OR;
             }
-        } else {
-            if (!inWord) {
-                // If it is not word, start new word
-                start = i;
-                inWord = 1;
+            return TOKEN_PIPE;
+        case '&':
+            if (str[1] == '&') {
+                *length = 2;
+                return TOKEN_AND;
             }
-        }
-        i++;
+            return TOKEN_BACKGROUND;
+        case ';':
+            return TOKEN_SEQ;
+        case '>':
+            if (str[1] == '>') {
+                *length = 2;
+                return TOKEN_APPEND;
+            }
+            return TOKEN_OUTPUT;
+        case '<':
+            return TOKEN_INPUT;
+        default:
+            return TOKEN_WORD;
+    }
+}
+
+// Function to append a token, doubling the arena-backed array when it is full
+// (one slot is always kept for the terminator)
+static struct Token* addToken(struct Arena* arena, struct Token* tokens, int* tokenCount, int* capacity, char* text, int length, int type) {
+    if (*tokenCount + 1 >= *capacity) {
+        *capacity *= 2;
+        struct Token* grown = (struct Token*)arenaAlloc(arena, *capacity * sizeof(struct Token));
+        memcpy(grown, tokens, *tokenCount * sizeof(struct Token));
+        tokens = grown;
     }
 
-    // Last word  handling
-    if (inWord) {
-        int length = i - start;
-        if (*wordCount >= wordBufferSize) {
-            wordBufferSize *= 2;
-            words = (char**)realloc(words, wordBufferSize * sizeof(char*));
-            if (words == NULL) {
-                perror("Memory overlocation");
-                exit(1);
-            }
+    tokens[*tokenCount].text = text;
+    tokens[*tokenCount].length = length;
+    tokens[(*tokenCount)++].type = type;
+    return tokens;
+}
+
+// Function for splitting a string into tokens in one pass. Every token is classified once;
+// words are NUL-terminated inside str, operators may be written without spaces ('a|b', 'cmd>out').
+// The token array comes from the arena
+struct Token* splitStringWithoutSpaces(struct Arena* arena, char* str, int* tokenCount) {
+    int capacity = strlen(str) / 4 + 8;
+    struct Token* tokens = (struct Token*)arenaAlloc(arena, capacity * sizeof(struct Token));
+    *tokenCount = 0;
+
+    char* current = str;
+    while (1) {
+        while (*current == ' ' || *current == '\t' || *current == '\n') {
+            current++;
+        }
+        if (*current == '\0' || *current == '#') { // '#' comments out the rest of the line
+            break;
+        }
+
+        int operatorLength;
+        int type = lexOperator(current, &operatorLength);
+        if (type != TOKEN_WORD) {
+            tokens = addToken(arena, tokens, tokenCount, &capacity, (char*)operatorText[type], operatorLength, type);
+            current += operatorLength;
+            continue;
         }
 
-        words[(*wordCount)] = (char*)malloc(length + 1);
-        if (words[(*wordCount)] == NULL) {
-            perror("Memory allocation");
-            exit(1);
+        char* word = current; // start of the word
+        while (*current != '\0' && *current != ' ' && *current != '\t' && *current != '\n') {
+            type = lexOperator(current, &operatorLength);
+            if (type != TOKEN_WORD) {
+                break;
+            }
+            current++;
+        }
+        tokens = addToken(arena, tokens, tokenCount, &capacity, word, (int)(current - word), TOKEN_WORD);
+
+        if (type != TOKEN_WORD) {
+            // Operator right after the word: keep its type, then cut the word on its first character
+            tokens = addToken(arena, tokens, tokenCount, &capacity, (char*)operatorText[type], operatorLength, type);
+            *current = '\0';
+            current += operatorLength;
+        } else if (*current == '\0') {
+            break;
+        } else {
+            *current++ = '\0'; // end of the word
         }
-        strncpy(words[(*wordCount)++], str + start, length);
-        words[*wordCount - 1][length] = '\0';
     }
 
-    return words;
+    tokens[*tokenCount].text = NULL;
+    tokens[*tokenCount].length = 0;
+    tokens[*tokenCount].type = TOKEN_WORD;
+    return tokens;
 }
 
 
-int isOperatorFlag(char** words, int currentFlag, int i, int* firstOperatorFlag, int* secondOperatorFlag) { // for commands
-	if (strcmp(words[i], "|") == 0) {
-            currentFlag = 1;
-        } else if (strcmp(words[i], "&") == 0) {
-            currentFlag = 2;
-        } else if (strcmp(words[i], "||") == 0) {
-            currentFlag = 3;
-            if (*firstOperatorFlag == 4 && *secondOperatorFlag == 0) {
-            	*secondOperatorFlag = 3;
-            }
-        } else if (strcmp(words[i], "&&") == 0) {
-            currentFlag = 4;
-            
-            if (*firstOperatorFlag == 3 && *secondOperatorFlag == 0) {
-            	*secondOperatorFlag = 4;
-            }
-        } else if (strcmp(words[i], ";") == 0) {
-            currentFlag = 5;
-        } else if (strcmp(words[i], ">") == 0) {
-        	currentFlag = 6;
-        } else if (strcmp(words[i], ">>") == 0) {
-        	currentFlag = 7;
-        	
-        } else if (strcmp(words[i], "<") == 0) {
-        	currentFlag = 8;
-        }
-        
-        return currentFlag;
-}
-
-
-int wordOpFlag(char** words, int currentFlag, int i) { // for words
-	if (strcmp(words[i], "|") == 0) {
-            currentFlag = 1;
-        } else if (strcmp(words[i], "&") == 0) {
-            currentFlag = 2;
-        } else if (strcmp(words[i], "||") == 0) {
-            currentFlag = 3;
-        } else if (strcmp(words[i], "&&") == 0) {
-            currentFlag = 4;
-            
-        } else if (strcmp(words[i], ";") == 0) {
-            currentFlag = 5;
-        } else if (strcmp(words[i], ">") == 0) {
-        	currentFlag = 6;
-        } else if (strcmp(words[i], ">>") == 0) {
-        	currentFlag = 7;
-        	
-        } else if (strcmp(words[i], "<") == 0) {
-        	currentFlag = 8;
-        }
-        
-        return currentFlag;
-}
-
-int isOperator(char** words, int i) {
-	if ((strcmp(words[i], "|") == 0) || (strcmp(words[i], "&") == 0) ||
-		(strcmp(words[i], "||") == 0) || (strcmp(words[i], "&&") == 0) ||
-		(strcmp(words[i], ";") == 0) || (strcmp(words[i], ">") == 0) ||
-		(strcmp(words[i], ">>") == 0) || (strcmp(words[i], "<") == 0)) {
-		return 1;
-	}
-	return 0;		
+// Parser state (recursive descent over the token array)
+struct Parser {
+    struct Arena* arena;
+    struct Token* tokens;
+    int tokenCount;
+    int position;
+    struct Ast* ast;
+};
+
+// Function to report a syntax error at the current token
+static int syntaxError(struct Parser* parser) {
+    const char* near = "newline";
+    if (parser->position < parser->tokenCount) {
+        near = parser->tokens[parser->position].text;
+    }
+
+    fprintf(stderr, "bash: syntax error near unexpected token '%s'\n", near);
+    return -1;
 }
 
-void freeCommand(struct Command** cmd);
+// Function to append a node to the AST array, returns its index
+static int addNode(struct Parser* parser, int type, int left, int right, struct Command* cmd) {
+    struct Node* node = &parser->ast->nodes[parser->ast->count];
+    node->type = type;
+    node->left = left;
+    node->right = right;
+    node->cmd = cmd;
+
+    return parser->ast->count++;
+}
 
+// Function to check whether a token type is a redirection
+static int isRedirect(int type) {
+    return type == TOKEN_OUTPUT || type == TOKEN_APPEND || type == TOKEN_INPUT;
+}
 
-// Function to parse an array of words into a linked list of Command structures
-struct Command* parseCommandsFromWords(char** words, int wordCount, int* firstOperatorFlag, int* secondOperatorFlag) {
-    struct Command* head = NULL;  // Command head
-    struct Command* current = NULL;
-    struct Command* lastWordCommand = NULL;
-    int currentFlag = 0; // Current flag for operators
+// Function to get the system limit for argv + environment of a new program
+static long argumentLimit() {
+    static long argMax = 0;
 
-    for (int i = 0; i < wordCount; i++) {
-        if (strcmp(words[i], "|") == 0 || strcmp(words[i], "&") == 0 ||
-            strcmp(words[i], "||") == 0 || strcmp(words[i], "&&") == 0 ||
-            strcmp(words[i], ";") == 0 || strcmp(words[i], ">") == 0 ||
-            strcmp(words[i], ">>") == 0 || strcmp(words[i], "<") == 0) {
-            *firstOperatorFlag = isOperatorFlag(words, currentFlag, i, firstOperatorFlag, secondOperatorFlag);
-            break;
+    if (argMax == 0) {
+        argMax = sysconf(_SC_ARG_MAX);
+        if (argMax <= 0) {
+            argMax = 131072;
         }
     }
+    return argMax;
+}
+
+// Function to measure the environment passed to every program
+static size_t environmentSize() {
+    extern char** environ;
+    size_t size = 0;
 
-    if (strcmp(words[wordCount - 1], "&") == 0) {
-        *secondOperatorFlag = 2;
+    for (char** variable = environ; *variable != NULL; variable++) {
+        size += sizeof(char*) + strlen(*variable) + 1;
     }
+    return size;
+}
 
-    for (int i = 0; i < wordCount; i++) {
-        struct Command* cmd = (struct Command*)malloc(sizeof(struct Command));
-        if (cmd == NULL) {
-            perror("Memory allocation");
-            freeCommand(&head);
-            return NULL;
+// command := (WORD | redirect WORD)+
+static struct Command* parseSimpleCommand(struct Parser* parser) {
+    struct Token* tokens = parser->tokens;
+
+    // Measure the words first: argv pointers and string bytes go into one block
+    int wordCount = 0;
+    size_t stringBytes = 0;
+    for (int i = parser->position; i < parser->tokenCount; i++) {
+        if (tokens[i].type == TOKEN_WORD) {
+            wordCount++;
+            stringBytes += tokens[i].length + 1;
+        } else if (isRedirect(tokens[i].type)) {
+            i++; // skip the file name
+        } else {
+            break;
         }
-        cmd->words = NULL;
-        cmd->flag = 0;
-        cmd->filename = NULL;
-        cmd->next = NULL;
+    }
 
-        if (head == NULL) {
-            head = cmd;
-            current = cmd;
-        } else {
-            current->next = cmd;
-            current = cmd;
-        }
-
-        int wordLength = strlen(words[i]);
-        cmd->words = (char**)malloc(10 * sizeof(char*));
-        if (cmd->words == NULL) {
-            perror("Memory allocation");
-            freeCommand(&head);
-            return NULL;
-        }
-        
-        for (int k = 0; k < 10; k++) {
-        	cmd->words[k] = NULL;
-        }
-
-        int j = 0;
-        int temp_flag = 0;
-        currentFlag = temp_flag;
-        while (words[i] != NULL) {
-            if (!isOperator(words, i)) {
-                cmd->words[j] = strdup(words[i]);
-                cmd->flag = currentFlag; // currentFlag's default value is 0
-            } else if (isOperator(words, i)) {
-                currentFlag = isOperatorFlag(words, temp_flag, i, firstOperatorFlag, secondOperatorFlag);
-                cmd->flag = currentFlag;
-                free(cmd->words[j]);
-                cmd->words[j] = NULL;
+    size_t argvBytes = (wordCount + 1) * sizeof(char*) + stringBytes;
+    if (argvBytes > 65536 && argvBytes + environmentSize() > (size_t)argumentLimit()) {
+        fprintf(stderr, "bash: %s: argument list too long (%d arguments, limit %ld bytes)\n",
+                tokens[parser->position].text, wordCount, argumentLimit());
+        return NULL;
+    }
+
+    struct Command* cmd = (struct Command*)arenaAlloc(parser->arena, sizeof(struct Command));
+    cmd->words = (char**)arenaAlloc(parser->arena, argvBytes);
+    cmd->redirects = NULL;
+    cmd->next = NULL;
+
+    char* strings = (char*)(cmd->words + wordCount + 1);
+    struct Redirect** tail = &cmd->redirects;
+    int word = 0;
+    while (parser->position < parser->tokenCount) {
+        struct Token* token = &tokens[parser->position];
+
+        if (token->type == TOKEN_WORD) {
+            memcpy(strings, token->text, token->length + 1);
+            cmd->words[word++] = strings;
+            strings += token->length + 1;
+            parser->position++;
+        } else if (isRedirect(token->type)) {
+            parser->position++;
+            if (parser->position >= parser->tokenCount || tokens[parser->position].type != TOKEN_WORD) {
+                syntaxError(parser);
+                return NULL;
             }
 
-	    if (currentFlag != 0) { 
-	   	break;
-	    }
-		
-	    i++;
-            j++;
+            struct Redirect* redirect = (struct Redirect*)arenaAlloc(parser->arena, sizeof(struct Redirect));
+            redirect->type = token->type;
+            redirect->filename = tokens[parser->position++].text;
+            redirect->next = NULL;
+            *tail = redirect;
+            tail = &redirect->next;
+        } else {
+            break;
         }
+    }
+    cmd->words[word] = NULL;
 
-        // Connect last word with a logical operator
-        if (lastWordCommand != NULL) {
-            lastWordCommand->next = cmd;
-        }
-        // Remember the last node
-        lastWordCommand = cmd;
+    if (word == 0) {
+        syntaxError(parser);
+        return NULL;
     }
 
-    return head;
+    return cmd;
 }
 
-// Function to free the memory allocated for Command structures
-void freeCommand(struct Command** cmd) {
-    struct Command* current = *cmd;
-    struct Command* next;
-
-    while (current != NULL) {
-        next = current->next;
-
-        for (int i = 0; current->words[i] != NULL; i++) {
-            free(current->words[i]);
-        }
-        
-        free(current->words);
-        free(current);
+// Function to check whether the current token is the 'time' keyword: the word 'time'
+// followed by the command to time ('time' alone runs as a command)
+static int atTimeKeyword(struct Parser* parser) {
+    return parser->position + 1 < parser->tokenCount &&
+           parser->tokens[parser->position].type == TOKEN_WORD &&
+           strcmp(parser->tokens[parser->position].text, "time") == 0 &&
+           parser->tokens[parser->position + 1].type == TOKEN_WORD;
+}
 
-        current = next;
+// pipeline := ['time'] command ('|' command)*
+static int parsePipeline(struct Parser* parser) {
+    // 'time' covers this pipeline, wherever it stands in the and-or list
+    if (atTimeKeyword(parser)) {
+        parser->position++;
+        int timed = parsePipeline(parser);
+        return (timed == -1) ? -1 : addNode(parser, NODE_TIME, timed, -1, NULL);
     }
 
-    *cmd = NULL;
-}
+    struct Command* head = parseSimpleCommand(parser);
+    if (head == NULL) {
+        return -1;
+    }
 
-// Two functions for cleaning memory of commands and a list of commands  
-void freeCmd(struct Command* cmd) {
-    struct Command* current = cmd;
-    
-    if (current != NULL) {
-    	for (int i = 0; current->words[i] != NULL; i++) {
-    		free(current->words[i]);
-    	}
-    	free(current->words);
-    	free(current);
+    struct Command* last = head;
+    while (parser->position < parser->tokenCount && parser->tokens[parser->position].type == TOKEN_PIPE) {
+        parser->position++;
+        last->next = parseSimpleCommand(parser);
+        if (last->next == NULL) {
+            return -1;
+        }
+        last = last->next;
     }
+
+    return addNode(parser, (head->next == NULL) ? NODE_COMMAND : NODE_PIPELINE, -1, -1, head);
 }
 
+// and-or := pipeline (('&&' | '||') pipeline)*
+static int parseAndOr(struct Parser* parser) {
+    int left = parsePipeline(parser);
 
-// Function to print the Command list
-void printCommands(struct Command* head) {
-    struct Command* current = head;
-    while (current != NULL) {
-        printf("Command words: \nFlag: %d\n", current->flag);
-        for (int i = 0; current->words != NULL && current->words[i] != NULL; ++i) {
-            printf("%s ", current->words[i]);
+    while (left != -1 && parser->position < parser->tokenCount) {
+        int type = parser->tokens[parser->position].type;
+        if (type != TOKEN_AND && type != TOKEN_OR) {
+            break;
         }
-        printf("\n");
+        parser->position++;
 
-        // Move to the next Command
-        current = current->next;
+        int right = parsePipeline(parser);
+        if (right == -1) {
+            return -1;
+        }
+        left = addNode(parser, (type == TOKEN_AND) ? NODE_AND : NODE_OR, left, right, NULL);
     }
+
+    return left;
 }
 
+// list := and-or ((';' | '&') and-or)* [';' | '&']
+static int parseList(struct Parser* parser) {
+    int list = -1;
 
-void executeAndOperator(struct Command* cmd) {
-    int status = 0;
-    
-    while (cmd != NULL) {
-        pid_t pid = fork();
-        if (pid == -1) {
-            perror("fork");
-            exit(1);
-        } else if (pid == 0) {
-            cmd->pid = getpid();
-            execvp(cmd->words[0], cmd->words);
-            perror("execvp");
-            exit(1);
-        } else {
-        	cmd->pid = pid;
-            wait(&status);
+    while (1) {
+        int item = parseAndOr(parser);
+        if (item == -1) {
+            return -1;
         }
-        cmd = cmd->next;
-    }
-}
 
-void executeOrOperator(struct Command* cmd) {
-    int status = 0;
-    while (cmd != NULL) {
-        pid_t pid = fork();
-        if (pid == -1) {
-            perror("fork");
-            exit(1);
-        } else if (pid == 0) {
-            execvp(cmd->words[0], cmd->words);
-            perror("execvp");
-            exit(1);
-        } else {
-        	cmd->pid = pid;
-            wait(&status);
-            if (status == 0) {
-                break;
+        int separator = TOKEN_SEQ;
+        if (parser->position < parser->tokenCount) {
+            separator = parser->tokens[parser->position].type;
+            if (separator != TOKEN_SEQ && separator != TOKEN_BACKGROUND) {
+                return syntaxError(parser);
             }
+            parser->position++;
         }
-        cmd = cmd->next;
-    }
-}
-
-void executeCommandSequence(struct Command* cmd) {
-    int status = 0;
-    int success = 1;  // To track success of the previous command in the sequence
-
-    while (cmd != NULL) {
-        if (cmd->flag == 4) {  // '&&'
-            if (success) {
-                pid_t pid = fork();
-                if (pid == -1) {
-                    perror("fork");
-                    exit(1);
-                } else if (pid == 0) {
-                    execvp(cmd->words[0], cmd->words);
-                    perror("execvp");
-                    exit(1);
-                } else {
-                	cmd->pid = pid;
-                    wait(&status);
-                    success = (status == 0);
-                }
-            }
-        } else if (cmd->flag == 3) {  // ''
-            pid_t pid = fork();
-            if (pid == -1) {
-                perror("fork");
-                exit(1);
-            } else if (pid == 0) {
-                execvp(cmd->words[0], cmd->words);
-                perror("execvp");
-                exit(1);
-            } else {
-            	cmd->pid = pid;
-                wait(&status);
-                if (status == 0) {
-                    // Break out of the loop if '' command succeeded
-                    break;
-                }
-            }
-        } else {  // Default, no operator
-            pid_t pid = fork();
-            if (pid == -1) {
-                perror("fork");
-                exit(1);
-            } else if (pid == 0) {
-                execvp(cmd->words[0], cmd->words);
-                perror("execvp");
-                exit(1);
-            } else {
-            	cmd->pid = pid;
-                wait(NULL);
-            }
+
+        if (separator == TOKEN_BACKGROUND) {
+            item = addNode(parser, NODE_BACKGROUND, item, -1, NULL);
         }
+        list = (list == -1) ? item : addNode(parser, NODE_SEQ, list, item, NULL);
 
-        cmd = cmd->next;
+        if (parser->position >= parser->tokenCount) {
+            return list;
+        }
     }
 }
 
-// Function for operator ';'
-void executeSeqOperator(struct Command* cmd) {
-    int status;
-    while (cmd != NULL) {
-        pid_t pid = fork();
-        if (pid == -1) {
-            perror("fork");
-            exit(1);
-        } else if (pid == 0) {
-            execvp(cmd->words[0], cmd->words);
-            perror("execvp");
-            exit(1);
-        } else {
-        	cmd->pid = pid;
-            wait(&status);
+// Function to parse an array of tokens into an array-backed AST (everything is taken
+// from the arena, the words are not copied). Returns NULL after a syntax error
+struct Ast* parseCommandsFromWords(struct Arena* arena, struct Token* tokens, int tokenCount) {
+    // Every node but the first command is created by an operator, at most three each:
+    // '&' before another item adds the item, NODE_BACKGROUND and NODE_SEQ.
+    // Each 'time' word may add a NODE_TIME
+    int operatorCount = 0;
+    int timeCount = 0;
+    for (int i = 0; i < tokenCount; i++) {
+        if (tokens[i].type != TOKEN_WORD) {
+            operatorCount++;
+        } else if (strcmp(tokens[i].text, "time") == 0) {
+            timeCount++;
         }
-        cmd = cmd->next;
     }
+
+    struct Ast* ast = (struct Ast*)arenaAlloc(arena, sizeof(struct Ast));
+    ast->nodes = (struct Node*)arenaAlloc(arena, (3 * operatorCount + 1 + timeCount) * sizeof(struct Node));
+    ast->count = 0;
+
+    struct Parser parser = {arena, tokens, tokenCount, 0, ast};
+    ast->root = parseList(&parser);
+    if (ast->root == -1) {
+        return NULL;
+    }
+
+    return ast;
 }
 
+// Function to measure one command's contiguous argv block (pointers, then strings),
+// rounded up so the next block stays pointer-aligned
+static size_t argvBlockSize(const struct Command* cmd) {
+    size_t size = sizeof(char*); // argv terminator
+    for (int i = 0; cmd->words[i] != NULL; i++) {
+        size += sizeof(char*) + strlen(cmd->words[i]) + 1;
+    }
+
+    return (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+}
 
-// operator '>'
-void outputInFile(struct Command* cmd, const char* filename) {
-    int fd[2];
-    pipe(fd);
-    
-   
-    pid_t pid = fork();
+// Function to measure a Command list packed by packCommandList(), rounded up so the
+// next packed object stays pointer-aligned
+static size_t commandListSize(const struct Command* cmd) {
+    size_t size = 0;
 
-    if (pid == -1) {
-        perror("fork");
-        exit(EXIT_FAILURE);
-    } else if (pid == 0) {
-        close(fd[0]);
+    for (const struct Command* current = cmd; current != NULL; current = current->next) {
+        size += sizeof(struct Command) + argvBlockSize(current);
+        for (struct Redirect* redirect = current->redirects; redirect != NULL; redirect = redirect->next) {
+            size += sizeof(struct Redirect) + strlen(redirect->filename) + 1;
+        }
+    }
 
-        if (dup2(fd[1], STDOUT_FILENO) == -1) {
-        	perror("dup2");
-        	exit(EXIT_FAILURE);
-        } 
-        
+    return (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+}
 
-        execvp(cmd->words[0], cmd->words); 
+// Function to pack a Command list into block (which must hold commandListSize() bytes).
+// Layout: Command nodes, Redirect nodes, one argv block per command (pointers followed
+// by their strings), then the file names
+static struct Command* packCommandList(const struct Command* cmd, char* block) {
+    int commandCount = 0;
+    int redirectCount = 0;
+
+    for (const struct Command* current = cmd; current != NULL; current = current->next) {
+        commandCount++;
+        for (struct Redirect* redirect = current->redirects; redirect != NULL; redirect = redirect->next) {
+            redirectCount++;
+        }
+    }
 
-        close(fd[1]); 
-        exit(EXIT_SUCCESS);
-    } else { 
-        close(fd[1]); 
+    struct Command* copy = (struct Command*)block;
+    struct Redirect* redirects = (struct Redirect*)(copy + commandCount);
+    char* cursor = (char*)(redirects + redirectCount);
 
-        FILE *file = fopen(filename, "w");
-        if (file == NULL) {
-            perror("fopen");
-            exit(EXIT_FAILURE);
+    struct Command* target = copy;
+    for (const struct Command* current = cmd; current != NULL; current = current->next, target++) {
+        int wordCount = 0;
+        while (current->words[wordCount] != NULL) {
+            wordCount++;
         }
 
-        char buffer[1024];
-        int bytes_read;
+        char** argv = (char**)cursor;
+        char* strings = (char*)(argv + wordCount + 1);
+        for (int i = 0; i < wordCount; i++) {
+            size_t length = strlen(current->words[i]) + 1;
+            memcpy(strings, current->words[i], length);
+            argv[i] = strings;
+            strings += length;
+        }
+        argv[wordCount] = NULL;
+        target->words = argv;
+        cursor += argvBlockSize(current);
+    }
 
-        while ((bytes_read = read(fd[0], buffer, sizeof(buffer))) > 0) {
-            for (int i = 0; i < bytes_read; i++) {
-                fputc(buffer[i], file);
-            }
+    target = copy;
+    for (const struct Command* current = cmd; current != NULL; current = current->next, target++) {
+        struct Redirect** tail = &target->redirects;
+        for (struct Redirect* redirect = current->redirects; redirect != NULL; redirect = redirect->next) {
+            size_t length = strlen(redirect->filename) + 1;
+            memcpy(cursor, redirect->filename, length);
+            redirects->type = redirect->type;
+            redirects->filename = cursor;
+            cursor += length;
+
+            *tail = redirects;
+            tail = &redirects->next;
+            redirects++;
         }
+        *tail = NULL;
 
-        fclose(file);
-        close(fd[0]);
-        
-        wait(NULL);
+        target->next = (current->next != NULL) ? target + 1 : NULL;
     }
+
+    return copy;
 }
 
-// operator '>>'
-void appendToFile(struct Command* cmd, const char* filename) {
-    int fd[2];
-    pipe(fd);
-    
-   
-    pid_t pid = fork();
+// Function to copy a Command list into one compact block, for jobs that outlive
+// the command line's arena. The copy is released with a single free()
+struct Command* copyCommandList(const struct Command* cmd) {
+    if (cmd == NULL) {
+        return NULL;
+    }
 
-    if (pid == -1) {
-        perror("fork");
-        exit(EXIT_FAILURE);
-    } else if (pid == 0) {
-        close(fd[0]);
+    char* block = (char*)malloc(commandListSize(cmd));
+    if (block == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
 
-        dup2(fd[1], STDOUT_FILENO);
+    return packCommandList(cmd, block);
+}
 
-        execvp(cmd->words[0], cmd->words); 
+// Function to copy a whole AST into one compact, immutable block (Ast header, node
+// array, then every packed Command list). The copy is released with a single free()
+struct Ast* copyAst(const struct Ast* ast) {
+    size_t size = sizeof(struct Ast) + ast->count * sizeof(struct Node);
+    for (int i = 0; i < ast->count; i++) {
+        if (ast->nodes[i].cmd != NULL) {
+            size += commandListSize(ast->nodes[i].cmd);
+        }
+    }
 
-        close(fd[1]); 
-        exit(EXIT_SUCCESS);
-    } else { 
-        close(fd[1]); 
+    char* block = (char*)malloc(size);
+    if (block == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
 
-        FILE *file = fopen(filename, "a");
-        if (file == NULL) {
-            perror("fopen");
-            exit(EXIT_FAILURE);
+    struct Ast* copy = (struct Ast*)block;
+    copy->nodes = (struct Node*)(copy + 1);
+    copy->count = ast->count;
+    copy->root = ast->root;
+
+    char* cursor = (char*)(copy->nodes + ast->count);
+    for (int i = 0; i < ast->count; i++) {
+        copy->nodes[i] = ast->nodes[i];
+        if (ast->nodes[i].cmd != NULL) {
+            copy->nodes[i].cmd = packCommandList(ast->nodes[i].cmd, cursor);
+            cursor += commandListSize(ast->nodes[i].cmd);
         }
+    }
 
-        char buffer[1024];
-        int bytes_read;
-        
-        while ((bytes_read = read(fd[0], buffer, sizeof(buffer))) > 0) {
-            for (int i = 0; i < bytes_read; i++) {
-                fputc(buffer[i], file);
-            }
+    return copy;
+}
+
+// Function to print the Command list
+void printCommands(struct Command* head) {
+    struct Command* current = head;
+    while (current != NULL) {
+        printf("Command words: \n");
+        for (int i = 0; current->words != NULL && current->words[i] != NULL; ++i) {
+            printf("%s ", current->words[i]);
+        }
+        for (struct Redirect* redirect = current->redirects; redirect != NULL; redirect = redirect->next) {
+            printf("%s %s ", operatorText[redirect->type], redirect->filename);
         }
+        printf("\n");
 
-        fclose(file);
-        close(fd[0]);
-        
-        wait(NULL);
+        // Move to the next Command
+        current = current->next;
     }
 }
 
-// operator '<'
-void inputFromFile(struct Command* cmd, const char* filename) {
-        int fd[2];
-        pipe(fd);
-
-        pid_t pid = fork();
-
-        if (pid == -1) {
-            perror("fork");
-            exit(EXIT_FAILURE);
-        } else if (pid == 0) {
 
-            close(fd[1]);  
-            
-            dup2(fd[0], STDIN_FILENO);
-            
-            execvp(cmd->words[0], cmd->words);
+// Function to open a command's redirections in order, close-on-exec. The last one for
+// stdin and for stdout wins, earlier files are still created. Returns -1 on failure
+int openRedirects(struct Command* cmd, int* inputFd, int* outputFd) {
+    *inputFd = -1;
+    *outputFd = -1;
 
-            close(fd[0]);
+    for (struct Redirect* redirect = cmd->redirects; redirect != NULL; redirect = redirect->next) {
+        int fd;
+        int* target = outputFd;
 
-            perror("execvp");
-            exit(EXIT_FAILURE);
+        if (redirect->type == TOKEN_OUTPUT) {
+            fd = open(redirect->filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        } else if (redirect->type == TOKEN_APPEND) {
+            fd = open(redirect->filename, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
         } else {
-            close(fd[0]);
+            fd = open(redirect->filename, O_RDONLY | O_CLOEXEC);
+            target = inputFd;
+        }
 
-            FILE *file = fopen(filename, "r");
-            if (file == NULL) {
-                perror("fopen");
-                exit(EXIT_FAILURE);
+        if (fd == -1) {
+            fprintf(stderr, "bash: %s: %s\n", redirect->filename, strerror(errno));
+            if (*inputFd != -1) {
+                close(*inputFd);
             }
-
-            char buffer[1024];
-            size_t bytesRead;
-
-            while ((bytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0) {
-                write(fd[1], buffer, bytesRead);
+            if (*outputFd != -1) {
+                close(*outputFd);
             }
+            return -1;
+        }
 
-            fclose(file);
-            close(fd[1]);
-
-            wait(NULL);
+        if (*target != -1) {
+            close(*target);
         }
+        *target = fd;
+    }
+
+    return 0;
 }
 
+// Function to apply a command's redirections to the current process: the file is placed
+// on stdin/stdout directly, the shell never copies the data. Returns -1 on failure
+int applyRedirects(struct Command* cmd) {
+    int inputFd;
+    int outputFd;
+    if (openRedirects(cmd, &inputFd, &outputFd) == -1) {
+        return -1;
+    }
 
-// pwd: path
-void pwd() {
-    char path[1024]; // Array for path
-    if (getcwd(path, sizeof(path)) != NULL) {
-        printf("\033[1;34m%s\033[0m$ ", path);
-    } else {
-        perror("getcwd");
+    if (inputFd != -1) {
+        dup2(inputFd, STDIN_FILENO);
+        close(inputFd);
     }
+    if (outputFd != -1) {
+        dup2(outputFd, STDOUT_FILENO);
+        close(outputFd);
+    }
+
+    return 0;
 }
 
+
 // cd: change directory
-void cd(const char* path) {
+int cd(const char* path) {
 	if (path == NULL) {
-		const char* home = "/home";
-		if (chdir(home) != 0) {
-			perror("bash: cd");
-		}
-	} else if (path == "..") {
-		if (chdir(path) != 0) {
-			perror("bash: cd");
-		}
-	} else {
-		if (chdir(path) != 0) {
-			perror("bash: cd");
-		}
+		path = "/home";
 	}
+
+	if (chdir(path) != 0) {
+		perror("bash: cd");
+		return 1;
+	}
+	refreshDirectory(); // The only place the shell's directory changes
+	return 0;
 }
 
-// echo: print on screen
-void echo(const char* str) {
-	if (str == NULL) printf("\n");
-	else printf("%s\n", str);
+// echo: print the arguments on screen
+void echo(char** args) {
+	for (int i = 0; args[i] != NULL; i++) {
+		if (i > 0) putchar(' ');
+		fputs(args[i], stdout);
+	}
+	putchar('\n');
 }
 
 // help: manual page with bash commands
 void help() {
     printf("\033[1;31mAvailable commands\033[0m:\n\n*****\n");
     printf("\033[1;32m____\033[0m\n\n"); // Green underline
-    printf("\033[1;31mpwd\033[0m [-LP] - Prints the absolute path to the screen.\n");
+    printf("\033[1;31mpwd\033[0m - Prints the absolute path to the screen.\n");
+    printf("The prompt is taken from $PS1: \\w directory (~ for $HOME), \\W its last part, \\j jobs, \\? last exit status, \\L last command's wall time, \\u user, \\h host, \\$ '#' for root, \\e escape, \\n newline.\n");
     printf("\033[1;31mls\033[0m [-LP-flags...] - Lists the current directory's content.\n");
     printf("\033[1;31mcd\033[0m [dir] - Changes directory.\n");
-    printf("\033[1;31mexit\033[0m - Closes the terminal.\n");
+    printf("\033[1;31mexit\033[0m [n] - Closes the terminal with status n.\n");
     printf("\033[1;31mclear\033[0m - Makes the terminal window empty.\n");
     printf("\033[1;31mecho\033[0m [arg ...] - Prints anything to the screen.\n");
     printf("\033[1;31mrm\033[0m [filename ...] - Remove a file or files.\n");
@@ -644,12 +706,17 @@ void help() {
     printf("\033[1;31mcat\033[0m [filename ...] - Prints the contents of a file or files.\n");
     printf("\033[1;32m____\033[0m\n\n"); // Green underline
     printf("\033[1;31mjobs\033[0m [args] - Lists the active jobs. Default: the status of all active jobs is displayed.\n");
-    printf("\033[1;31mbg\033[0m [job(pid or name)] - Transfer a job in the background mode.\n");
-    printf("\033[1;31mfg\033[0m [job(pid or name)] - Transfer a job in the foreground(active) mode.\n");
+    printf("\033[1;31mbg\033[0m [job(%%N, pid or name)] - Transfer a job in the background mode.\n");
+    printf("\033[1;31mfg\033[0m [job(%%N, pid or name)] - Transfer a job in the foreground(active) mode.\n");
     printf("\033[1;31mkill\033[0m [signal name(flags: '-l'...)] [job pid or job name] - Sends the signals to job\n");
-    printf("\033[1;31mwait\033[0m [job(pid or name)] - Wait for job completion\n");
+    printf("\033[1;31mparallel\033[0m [-j N] [command ...] [::: input ...] - Runs 'command input' for every input (the words after ':::', else the lines of stdin) with at most N running at once (default: the number of CPUs). Each command's output is printed as one block when it ends. Returns the number of failed commands.\n");
+    printf("\033[1;31mwait\033[0m [-n] [job(%%N, pid or name) ...] - Wait for the given jobs, all running jobs, or with [-n] the next one to finish.\n");
+    printf("\033[1;31mset\033[0m [-o|+o trace-timing] - Turns tracing of the shell's own phases (read, tokenize, parse, spawn/fork, exec, wait for the child, reap) on or off. Records are JSON lines written to fd $BASH_TRACE_FD (default stderr); setting $BASH_TRACE_FD at startup turns it on. bench/tracesum summarizes them.\n");
+    printf("\033[1;31mtime\033[0m command [| ...] - Runs the command (or pipeline) and prints its wall time, user and system CPU time, max RSS, page faults and context switches to stderr, per stage for pipelines.\n");
     printf("\033[1;32m____\033[0m\n\n"); // Green underline
-    printf("\033[1;31mhistory\033[0m [-c] - Default: Display the history list with line numbers. With option [-c] it clears the history list.\n");
+    printf("\033[1;31mcache\033[0m - Shows hit/miss counters of the parsed-command cache.\n");
+    printf("\033[1;31mhash\033[0m [-r] [name ...] - Shows or fills the table of resolved command paths, [-r] empties it.\n");
+    printf("\033[1;31mhistory\033[0m [-c] [-s pattern] [--stats] - Default: Display the history list with line numbers. With option [-c] it clears the history list, with [-s pattern] it lists the commands containing pattern, most recent first (CTRL + R searches interactively), with [--stats] it shows the slowest (wall, CPU time, status) and the most frequent commands. Interactive commands are saved to $HISTFILE (default ~/.bash_history), the last $HISTSIZE (default 1000) are loaded at startup.\n");
 }
 
 
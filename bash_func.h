@@ -3,97 +3,327 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <unistd.h>
+#include <termios.h>
 
 
-// Structure Command
+// Token types (operator types are the Command flag values)
+#define TOKEN_WORD 0
+#define TOKEN_PIPE 1       // '|'
+#define TOKEN_BACKGROUND 2 // '&'
+#define TOKEN_OR 3         // '||'
+#define TOKEN_AND 4        // '&&'
+#define TOKEN_SEQ 5        // ';'
+#define TOKEN_OUTPUT 6     // '>'
+#define TOKEN_APPEND 7     // '>>'
+#define TOKEN_INPUT 8      // '<'
+
+
+// Structure Token
+struct Token {
+    char* text; // Word (NUL-terminated in the line) or operator text
+    int length; // Text length
+    int type;   // TOKEN_WORD or an operator type
+};
+
+
+// Structure Redirect (redirection node of a command)
+struct Redirect {
+    int type;              // TOKEN_OUTPUT, TOKEN_APPEND or TOKEN_INPUT
+    char* filename;        // Target file
+    struct Redirect* next; // Next Redirect
+};
+
+
+// Structure Command (simple command)
 struct Command {
-    char** words;         // Command words
-    int flag;             // Operator flag (0 - default, 1 - '|', 2 - '&', 3 - '||', 4 - '&&', .....)
-    pid_t pid;
-    struct Command* next; // Next Command
-    char* filename;       // for several functions
+    char** words;               // Command words (argv pointers followed by the strings, one block)
+    struct Redirect* redirects; // Redirections in order
+    struct Command* next;       // Next pipeline stage
+};
+
+
+// AST node types
+#define NODE_COMMAND 1    // Simple command (cmd)
+#define NODE_PIPELINE 2   // cmd | cmd->next | ...
+#define NODE_AND 3        // left && right
+#define NODE_OR 4         // left || right
+#define NODE_SEQ 5        // left ; right
+#define NODE_BACKGROUND 6 // left &
+#define NODE_TIME 7       // time left
+
+
+// Structure Node (AST nodes refer to each other by index)
+struct Node {
+    int type;            // Node type
+    int left;            // Left child index (-1 - none)
+    int right;           // Right child index (-1 - none)
+    struct Command* cmd; // Commands of NODE_COMMAND and NODE_PIPELINE
+};
+
+
+// Structure Ast (array-backed syntax tree of one command line)
+struct Ast {
+    struct Node* nodes; // Node array
+    int count;          // Number of nodes
+    int root;           // Root node index
 };
 
 
-// Structure Job
+// Job table indexes (member processes have their own pid index)
+#define JOB_BY_PGID 0
+#define JOB_BY_NUMBER 1
+#define JOB_INDEX_COUNT 2
+
+// Structure Process (one member of a job)
+struct Process {
+    pid_t pid;             // Process ID
+    int state;             // 0 - running, 1 - stopped, 2 - done
+    int status;            // Wait status once done
+    struct Job* job;       // Job it belongs to
+    struct Process* chain; // Next Process in the same pid bucket
+};
+
+// Structure Job (one process group: a command or a whole pipeline)
 struct Job {
-    pid_t pid;       // Process ID
-    pid_t pgid;      // Process Group ID
-    char* command;   // Command string
+    pid_t pid;       // Main process ID (the last pipeline stage)
+    pid_t pgid;      // Process Group ID, signals go to the whole group
+    int number;      // Job number (%N)
+    char* command;   // Display text, built once
     int state;       // Process state (0 - running, 1 - stopped, 2 - terminated, ...)
+    int pidfd;       // Main process file descriptor (-1 when not available)
     struct Command* commands; // List of commands
-    struct Job* next; // Next Job
+    struct Job* next; // Next Job (display order)
+    struct Job* prev; // Previous Job
+    struct Job* chain[JOB_INDEX_COUNT]; // Next Job in the same bucket of each index
+    int processCount;               // Number of member processes
+    struct Process processes[];     // Members in pipeline order
+};
+
+
+// Structure LineReader (block input)
+struct LineReader {
+    int fd;          // Input file descriptor
+    char* buffer;    // Reusable block buffer
+    size_t capacity; // Buffer size
+    size_t start;    // Start of the unread data
+    size_t scan;     // Data before this offset has no '\n'
+    size_t end;      // End of the valid data
+    int eof;         // End of input reached
 };
 
 
-// Structure for command history
+// Structure LineEditor (interactive input in raw terminal mode)
+struct LineEditor {
+    int fd;            // Terminal file descriptor
+    char* line;        // Edited line
+    size_t length;
+    size_t capacity;
+    char pending[256]; // Keys read but not handled yet
+    int pendingStart;
+    int pendingEnd;
+    struct termios saved; // Terminal settings outside of editing
+    int rawMode;          // Terminal is in raw mode
+};
+
+
+// Structure ArenaBlock
+struct ArenaBlock {
+    struct ArenaBlock* next; // Previous (older) block
+    size_t size;             // Usable bytes in data
+    size_t used;             // Bytes handed out
+    _Alignas(16) char data[];
+};
+
+
+// Structure Arena (memory for one command line)
+struct Arena {
+    struct ArenaBlock* head; // Current block
+    size_t total;            // Size of all blocks
+};
+
+
+// Structure HistoryEntry (one command line that was run)
+struct HistoryEntry {
+    struct HistoryText* text; // Interned command, repeats share it
+    time_t started;           // Start time, 0 for entries loaded from the history file
+    long wallUs;              // Wall time in microseconds, -1 while running or unknown
+    long cpuUs;               // User + system CPU time of its foreground children
+    int status;               // Exit status
+};
+
+// Structure for command history (ring of the newest commands)
 struct History {
-    char* command;
-    struct History* next;
+    struct HistoryEntry* entries; // capacity slots, the oldest entry is at start
+    int capacity;    // Entries kept (HISTSIZE)
+    int start;
+    int count;
+    long number;     // History number of the oldest entry
+    int fd;          // History file opened for appending, -1 when not saved
+};
+
+
+// Structure Builtin (command run inside the shell)
+struct Builtin {
+    const char* name; // Command name
+    int (*function)(struct Command* cmd, struct Job** jobList, struct History** historyList); // Returns exit status
 };
 
 
 // For Jobs
-struct Job* createJob(pid_t pid, pid_t pgid, char* command, int state, struct Command* commands);
+struct Job* createJob(pid_t pgid, const struct Process* processes, int count, int state, struct Command* commands);
 void addJob(struct Job** jobList, struct Job* newJob);
 int getJobCount(struct Job* jobList);
 struct Job* getLastJob(struct Job* jobList);
 struct Job* findJobByPid(struct Job* jobList, char* identifier);
+struct Process* findProcess(struct Job* jobList, pid_t pid);
+struct Job* findJobByProcess(struct Job* jobList, pid_t pid);
+struct Job* findJobByPGID(struct Job* jobList, pid_t pgid);
+struct Job* findJobByNumber(struct Job* jobList, int number);
 void removeFromJobList(struct Job** jobList, pid_t pid);
-void updateJobList(struct Job** jobList);
+void initChildSignals();
+int childEventFd();
+int reapChildren(struct Job** jobList, int atPrompt);
+void finishJob(struct Job** jobList, struct Job* job, int status, int newLine);
+int updateProcess(struct Job** jobList, pid_t pid, int status, int newLine);
+int signalJob(struct Job* job, int sig);
+long finishedJobCount();
+int lastFinishedStatus();
 void bringToForeground(struct Job** jobList, char* identifier);
 void killProcessByIdentifier(struct Command* commands, struct Job** jobList, char** identifierArray);
 void resumeInBackground(struct Job** jobList, char* identifier);
-void waitProcess(struct Job** jobList, pid_t pid);
 void printJobs(struct Job* job);
 void printJobsWithCommands(struct Job* jobList);
 
 
 // Command processing
-char* characterInput();
-char** splitStringWithoutSpaces(char* str, int* wordCount);
-struct Command* parseCommandsFromWords(char** words, int wordCount, int* firstOperatorFlag, int* secondOperatorFlag);
+void initLineReader(struct LineReader* reader, int fd);
+char* readLine(struct LineReader* reader, size_t* length);
+void freeLineReader(struct LineReader* reader);
+unsigned long hashBytes(const char* data, size_t length);
+void initLineEditor(struct LineEditor* editor, int fd);
+void startEditing(struct LineEditor* editor);
+void stopEditing(struct LineEditor* editor);
+char* editLine(struct LineEditor* editor, const struct History* history, size_t* length);
+int keysPending(const struct LineEditor* editor);
+void freeLineEditor(struct LineEditor* editor);
+struct Token* splitStringWithoutSpaces(struct Arena* arena, char* str, int* tokenCount);
+struct Ast* parseCommandsFromWords(struct Arena* arena, struct Token* tokens, int tokenCount);
+struct Command* copyCommandList(const struct Command* cmd);
+struct Ast* copyAst(const struct Ast* ast);
 void printCommand(struct Command* head);
 
 
 // Command Operators
-void executeCommand(struct Command* cmd, struct Job** jobList, struct History** historyList, int firstOperatorFlag, int secondFlag);
+int executeCommand(struct Ast* ast, struct Job** jobList, struct History** historyList);
+int executeNode(struct Ast* ast, int index, struct Job** jobList, struct History** historyList);
 
-void executePipeline(struct Command* cmd, struct Job** jobList);
-void executeDefault(struct Command* cmd, struct Job** jobList, struct History** historyList);
-void executeInBackground(struct Command* cmd, struct Job** jobList);
-void executeSeqOperator(struct Command* cmd);
-void executeCommandSequence(struct Command* cmd);
-void executeOrOperator(struct Command* cmd);
-void executeAndOperator(struct Command* cmd);
+int executePipeline(struct Command* cmd, struct Job** jobList, struct History** historyList);
+int executeDefault(struct Command* cmd, struct Job** jobList, struct History** historyList);
+long takeForegroundCpu();
+void executeInBackground(struct Command* cmd, struct Job** jobList, struct History** historyList);
+void PipelineBackground(struct Command* cmd, struct Job** jobList, struct History** historyList);
+
+// 'time' prefix (resource use per stage)
+int executeTimed(struct Ast* ast, int index, struct Job** jobList, struct History** historyList);
+int timingActive();
+void recordStage(const struct Command* cmd, pid_t pid, const struct rusage* usage);
+
+// Process launch; spawnCommand() returns a pid or one of these
+#define SPAWN_FAILED -1          // Not found or not started (status 127)
+#define SPAWN_REDIRECT_FAILED -2 // A redirection could not be opened (status 1)
+pid_t spawnCommand(struct Command* cmd, pid_t pgid, int terminalFd, int inputFd, int outputFd, int errorFd,
+                   struct Job** jobList, struct History** historyList);
+pid_t forkChild(pid_t pgid);
+
+// Bounded parallel runs ('parallel -j N')
+int runParallel(long jobs, char** prefix, int prefixCount, char** arguments,
+                struct Job** jobList, struct History** historyList);
 
 
 // Redirection input and output
-void outputInFile(struct Command* cmd, const char* filename);
-void appendToFile(struct Command* cmd, const char* filename);
-void inputFromFile(struct Command* cmd, const char* filename); 
+int openRedirects(struct Command* cmd, int* inputFd, int* outputFd);
+int applyRedirects(struct Command* cmd);
 
 
 
 // Other Bash commands
-void pwd();
-void cd(const char* path);
-void echo(const char* str);
+int cd(const char* path);
+void echo(char** args);
 void help();
 int isFile(const char* filename);
 void removeFile(struct Command* cmd);
 void touch(const char* filename);
 
 
+// For the prompt (cached directory, PS1)
+void refreshDirectory();
+const char* currentDirectory();
+void checkDirectory();
+void printPrompt(int jobCount, int status, long durationUs);
+void reprintPrompt();
+
 // For Bash History
-struct History* createHistoryNode(char* command);
+void loadHistory(struct History** historyList);
 void addToHistory(struct History** historyList, char* command);
 void printHistory(const struct History* historyList);
 void freeHistory(struct History* historyList);
 void clearHistory(struct History** historyList);
+void finishHistoryEntry(struct History* history, int status, long wallUs, long cpuUs);
+void printHistoryStats(const struct History* historyList);
+const char* historyEntry(const struct History* history, long number);
+int printHistoryMatches(const struct History* historyList, const char* pattern);
+
+// For reverse history search (trigram index)
+void indexHistoryEntry(unsigned int number, const char* command, size_t length, unsigned int oldest);
+long searchHistory(const struct History* history, const char* pattern, long before);
+void clearHistoryIndex();
+
+// Builtin registry
+struct Builtin* findBuiltin(const char* name);
+int runBuiltin(struct Builtin* builtin, struct Command* cmd, struct Job** jobList, struct History** historyList);
+int exitRequested();
+
+// Event loop (epoll over pidfds, SIGCHLD and stdin)
+void initEventLoop();
+void closeEventLoop();
+int watchProcess(pid_t pid);
+void unwatchProcess(int pidfd);
+int signalProcess(struct Job* job, int sig);
+int waitForEvents(struct Job** jobList, int watchInput, int* notices);
+int waitForJobs(struct Job** jobList, char** pids, int any);
+
+// Phase tracing ('set -o trace-timing', $BASH_TRACE_FD)
+void initTracing();
+void setTracing(int on);
+int tracingEnabled();
+int traceDescriptor();
+long traceClock();
+void traceNextCommand();
+void traceSpan(const char* phase, long start, long end, pid_t pid);
+void tracePhase(const char* phase, long start, pid_t pid);
+
+// PATH lookup table ('hash')
+const char* lookupCommandPath(const char* name);
+void forgetCommandPath(const char* name);
+int rememberCommandPath(const char* name);
+void printCommandPaths();
+void clearCommandPaths();
+
+// Parsed-command cache
+struct Ast* lookupParseCache(const char* line, size_t length);
+struct Ast* storeParseCache(const char* line, size_t length, const struct Ast* ast);
+void printParseCacheStats();
+void clearParseCache();
+
+// Arena allocator
+void initArena(struct Arena* arena);
+void* arenaAlloc(struct Arena* arena, size_t size);
+char* arenaStrndup(struct Arena* arena, const char* str, size_t length);
+void resetArena(struct Arena* arena);
+void freeArena(struct Arena* arena);
 
 // Free memory 
-void freeCommand(struct Command** cmd);
-void freeCmd(struct Command* cmd);
 void clearJobs(struct Job** jobList); 
+void closeJobDescriptors();
@@ -0,0 +1,101 @@
+// Benchmark: history insert, print, search and load with a large history
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../bash_func.h"
+
+#define ENTRIES 1000000
+#define DISTINCT 50000 // Different command lines, the rest repeat them
+#define SEARCHES 10000
+
+static double nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void report(const char* operation, long count, double elapsed) {
+    printf("{\"bench\":\"history\",\"entries\":%d,\"op\":\"%s\",\"ns_per_op\":%.1f}\n",
+           ENTRIES, operation, elapsed / count);
+}
+
+// Function to make the command line of entry i
+static void commandLine(char* line, size_t size, long i) {
+    static const char* programs[] = {"git status", "make -j8", "ls -la", "grep -rn", "cd src"};
+    long id = (i * 7919) % DISTINCT;
+    snprintf(line, size, "%s target%ld --flag=%ld", programs[id % 5], id, id % 97);
+}
+
+int main() {
+    char path[] = "/tmp/bench_historyXXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+
+    char size[32];
+    snprintf(size, sizeof(size), "%d", ENTRIES);
+    setenv("HISTSIZE", size, 1);
+    setenv("HISTFILE", path, 1);
+
+    // The file is opened by loadHistory, so inserts also append to it
+    struct History* history = NULL;
+    loadHistory(&history);
+
+    char line[128];
+    double start = nowNs();
+    for (long i = 0; i < ENTRIES; i++) {
+        commandLine(line, sizeof(line), i);
+        addToHistory(&history, line);
+        finishHistoryEntry(history, 0, 1000, 500);
+    }
+    report("insert", ENTRIES, nowNs() - start);
+
+    FILE* saved = fdopen(dup(STDOUT_FILENO), "w");
+    if (saved == NULL || freopen("/dev/null", "w", stdout) == NULL) {
+        perror("/dev/null");
+        return 1;
+    }
+    start = nowNs();
+    printHistory(history);
+    fflush(stdout);
+    double printed = nowNs() - start;
+    dup2(fileno(saved), STDOUT_FILENO);
+    fclose(saved);
+    report("print", ENTRIES, printed);
+
+    // Rare: one distinct line; common: a word in a fifth of the lines; short: below a
+    // trigram, found and missing (the first keys typed into CTRL + R)
+    const char* patterns[][2] = {{"search_rare", "target4242 "}, {"search_common", "make -j8"},
+                                 {"search_short", "j8"}, {"search_short_missing", "zz"}};
+    for (int p = 0; p < 4; p++) {
+        long found = 0;
+        start = nowNs();
+        for (int i = 0; i < SEARCHES; i++) {
+            long before = history->number + history->count - (long)i * 97;
+            found += searchHistory(history, patterns[p][1], before) != -1;
+        }
+        report(patterns[p][0], SEARCHES, nowNs() - start);
+        if (found == 0 && p < 3) {
+            fprintf(stderr, "history: '%s' not found\n", patterns[p][1]);
+            return 1;
+        }
+    }
+
+    freeHistory(history);
+    history = NULL;
+
+    start = nowNs();
+    loadHistory(&history);
+    report("load", ENTRIES, nowNs() - start);
+
+    freeHistory(history);
+    clearHistoryIndex();
+    unlink(path);
+    return 0;
+}
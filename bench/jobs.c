@@ -0,0 +1,89 @@
+// Benchmark: job table operations with many concurrent jobs
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../bash_func.h"
+
+#define JOB_COUNT 10000
+#define FIRST_PID 5000000 // Above pid_max, so no pidfd refers to a real process
+
+static double nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void report(const char* operation, double elapsed) {
+    printf("{\"bench\":\"job_table\",\"jobs\":%d,\"op\":\"%s\",\"ns_per_op\":%.1f}\n",
+           JOB_COUNT, operation, elapsed / JOB_COUNT);
+}
+
+int main() {
+    struct Job* jobList = NULL;
+    static struct Job* jobs[JOB_COUNT];
+    static char identifiers[JOB_COUNT][16];
+
+    struct Arena arena;
+    initArena(&arena);
+    char line[] = "sleep 100";
+    int tokenCount;
+    struct Token* tokens = splitStringWithoutSpaces(&arena, line, &tokenCount);
+    struct Ast* ast = parseCommandsFromWords(&arena, tokens, tokenCount);
+    struct Command* cmd = ast->nodes[ast->root].cmd;
+
+    for (int i = 0; i < JOB_COUNT; i++) {
+        struct Process process = {FIRST_PID + i, 0, 0, NULL, NULL};
+        jobs[i] = createJob(FIRST_PID + i, &process, 1, 0, cmd);
+    }
+
+    double start = nowNs();
+    for (int i = 0; i < JOB_COUNT; i++) {
+        addJob(&jobList, jobs[i]);
+    }
+    report("add", nowNs() - start);
+
+    long found = 0;
+    start = nowNs();
+    for (int i = 0; i < JOB_COUNT; i++) {
+        found += findJobByProcess(jobList, FIRST_PID + (i * 7919) % JOB_COUNT) != NULL;
+    }
+    report("find_pid", nowNs() - start);
+
+    start = nowNs();
+    for (int i = 0; i < JOB_COUNT; i++) {
+        found += findJobByPGID(jobList, FIRST_PID + (i * 7919) % JOB_COUNT) != NULL;
+    }
+    report("find_pgid", nowNs() - start);
+
+    for (int i = 0; i < JOB_COUNT; i++) {
+        snprintf(identifiers[i], sizeof(identifiers[i]), "%%%d", 1 + (i * 7919) % JOB_COUNT);
+    }
+    start = nowNs();
+    for (int i = 0; i < JOB_COUNT; i++) {
+        found += findJobByPid(jobList, identifiers[i]) != NULL;
+    }
+    report("find_number", nowNs() - start);
+
+    start = nowNs();
+    for (int i = 0; i < JOB_COUNT; i++) {
+        found += getJobCount(jobList) > 0 && getLastJob(jobList) != NULL;
+    }
+    report("count_last", nowNs() - start);
+
+    // Remove in a scattered order, as jobs finish
+    start = nowNs();
+    for (int i = 0; i < JOB_COUNT; i++) {
+        removeFromJobList(&jobList, FIRST_PID + (i * 7919) % JOB_COUNT);
+    }
+    report("remove", nowNs() - start);
+
+    if (found != 4L * JOB_COUNT || jobList != NULL) {
+        fprintf(stderr, "job table benchmark: wrong results\n");
+        return 1;
+    }
+
+    freeArena(&arena);
+    return 0;
+}
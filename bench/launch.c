@@ -0,0 +1,90 @@
+// Benchmark: launch latency of 'true' through the default executor, and pipelines of
+// 1 to 8 stages (latency of 'true | true ...', throughput of 'head | cat ...')
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+
+#include "../bash_func.h"
+
+#define LAUNCHES 2000
+#define PIPELINE_RUNS 200
+#define MAX_STAGES 8
+#define PIPELINE_MIB 256
+
+static double nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Function to parse a command line into the arena, NULL on a syntax error
+static struct Ast* parseLine(struct Arena* arena, const char* text) {
+    char* line = arenaStrndup(arena, text, strlen(text));
+    int tokenCount;
+    struct Token* tokens = splitStringWithoutSpaces(arena, line, &tokenCount);
+    return parseCommandsFromWords(arena, tokens, tokenCount);
+}
+
+// Function to build 'first | cat | cat ...' with stages commands, output to last
+static void buildPipeline(char* line, size_t size, const char* first, const char* stage, int stages, const char* last) {
+    size_t length = snprintf(line, size, "%s", first);
+    for (int i = 1; i < stages; i++) {
+        length += snprintf(line + length, size - length, " | %s", stage);
+    }
+    snprintf(line + length, size - length, "%s", last);
+}
+
+// Function to run a parsed line runs times, returns ns per run or -1 when it failed
+static double timeRuns(struct Ast* ast, int runs, struct Job** jobList, struct History** historyList) {
+    double start = nowNs();
+    for (int i = 0; i < runs; i++) {
+        if (executeCommand(ast, jobList, historyList) != 0) {
+            return -1;
+        }
+    }
+    return (nowNs() - start) / runs;
+}
+
+int main() {
+    struct Job* jobList = NULL;
+    struct History* historyList = NULL;
+    struct Arena arena;
+    char line[512];
+
+    // As in the shell: the bench may own the terminal and hand it to the children
+    signal(SIGTTOU, SIG_IGN);
+    signal(SIGTTIN, SIG_IGN);
+    initArena(&arena);
+
+    struct Ast* ast = parseLine(&arena, "true");
+    double elapsed = timeRuns(ast, LAUNCHES, &jobList, &historyList);
+    printf("{\"bench\":\"launch\",\"command\":\"true\",\"runs\":%d,\"us_per_launch\":%.1f}\n",
+           LAUNCHES, elapsed / 1e3);
+
+    for (int stages = 1; stages <= MAX_STAGES; stages++) {
+        buildPipeline(line, sizeof(line), "true", "true", stages, "");
+        elapsed = timeRuns(parseLine(&arena, line), PIPELINE_RUNS, &jobList, &historyList);
+        printf("{\"bench\":\"pipeline_latency\",\"stages\":%d,\"runs\":%d,\"us_per_run\":%.1f}\n",
+               stages, PIPELINE_RUNS, elapsed / 1e3);
+    }
+
+    for (int stages = 1; stages <= MAX_STAGES; stages++) {
+        char first[64];
+        snprintf(first, sizeof(first), "head -c %dM /dev/zero", PIPELINE_MIB);
+        buildPipeline(line, sizeof(line), first, "cat", stages, " > /dev/null");
+        elapsed = timeRuns(parseLine(&arena, line), 1, &jobList, &historyList);
+        if (elapsed < 0) {
+            printf("{\"bench\":\"pipeline_throughput\",\"stages\":%d,\"error\":true}\n", stages);
+            continue;
+        }
+        printf("{\"bench\":\"pipeline_throughput\",\"stages\":%d,\"mib\":%d,\"ms\":%.1f,\"mib_per_s\":%.1f}\n",
+               stages, PIPELINE_MIB, elapsed / 1e6, PIPELINE_MIB / (elapsed / 1e9));
+    }
+
+    freeArena(&arena);
+    clearParseCache();
+    clearCommandPaths();
+    return 0;
+}
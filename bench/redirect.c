@@ -0,0 +1,82 @@
+// Benchmark: throughput of '>' and '<' redirections, compared with /bin/sh and with
+// data proxied through an extra process. Usage: bench/redirect [MiB]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define DEFAULT_MIB 2048
+
+static double nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Function to run 'shell -c script' and return the elapsed time in ns, or -1 on failure
+static double runScript(const char* shell, const char* script) {
+    double start = nowNs();
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        return -1;
+    } else if (pid == 0) {
+        execl(shell, shell, "-c", script, (char*)NULL);
+        perror(shell);
+        _exit(127);
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return -1;
+    }
+
+    return nowNs() - start;
+}
+
+static void report(const char* name, const char* shell, long mib, double elapsed) {
+    if (elapsed < 0) {
+        printf("{\"bench\":\"%s\",\"shell\":\"%s\",\"error\":true}\n", name, shell);
+        return;
+    }
+    printf("{\"bench\":\"%s\",\"shell\":\"%s\",\"mib\":%ld,\"ms\":%.1f,\"mib_per_s\":%.1f}\n",
+           name, shell, mib, elapsed / 1e6, mib / (elapsed / 1e9));
+}
+
+int main(int argc, char* argv[]) {
+    long mib = (argc > 1) ? atol(argv[1]) : DEFAULT_MIB;
+    const char* shells[] = {"./bash", "/bin/sh"};
+
+    char path[] = "/tmp/bash-bench-redirect-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+
+    char writeScript[512];
+    char appendScript[512];
+    char proxiedScript[512];
+    char readScript[512];
+    snprintf(writeScript, sizeof(writeScript), "head -c %ldM /dev/zero > %s", mib, path);
+    snprintf(appendScript, sizeof(appendScript), "head -c %ldM /dev/zero >> %s", mib, path);
+    snprintf(proxiedScript, sizeof(proxiedScript), "head -c %ldM /dev/zero | cat > %s", mib, path);
+    snprintf(readScript, sizeof(readScript), "cat < %s > /dev/null", path);
+
+    for (int i = 0; i < (int)(sizeof(shells) / sizeof(shells[0])); i++) {
+        report("redirect_out", shells[i], mib, runScript(shells[i], writeScript));
+        report("redirect_in", shells[i], mib, runScript(shells[i], readScript));
+
+        truncate(path, 0);
+        report("redirect_append", shells[i], mib, runScript(shells[i], appendScript));
+        report("redirect_proxied", shells[i], mib, runScript(shells[i], proxiedScript));
+    }
+
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Benchmark: allocations and time per command line for tokenizing and parsing
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../bash_func.h"
+
+#define ITERATIONS 20000
+
+static long allocationCount = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+// Counting wrappers (linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc)
+void* __wrap_malloc(size_t size) {
+    allocationCount++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    allocationCount++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    allocationCount++;
+    return __real_realloc(ptr, size);
+}
+
+// Function to build a line of wordCount words: pipelines of 4-word commands
+static void buildLine(char* line, int wordCount) {
+    line[0] = '\0';
+    for (int i = 0; i < wordCount; i++) {
+        if (i > 0 && i % 4 == 0) {
+            strcat(line, " | ");
+        } else if (i > 0) {
+            strcat(line, " ");
+        }
+        char word[32];
+        snprintf(word, sizeof(word), "word%d", i);
+        strcat(line, word);
+    }
+}
+
+static double nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Function to check that a list of background jobs fits its node array:
+// 'a & b & c' needs three commands, two NODE_BACKGROUND and two NODE_SEQ
+static int checkBackgroundList(struct Arena* arena) {
+    char line[] = "a & b & c";
+    int tokenCount;
+    struct Token* tokens = splitStringWithoutSpaces(arena, line, &tokenCount);
+    struct Ast* ast = parseCommandsFromWords(arena, tokens, tokenCount);
+    int ok = (ast != NULL && ast->count == 7);
+    if (ok) {
+        free(copyAst(ast)); // Walks every node
+    }
+
+    resetArena(arena);
+    if (!ok) {
+        fprintf(stderr, "tokenizer: 'a & b & c' parsed wrong\n");
+    }
+    return ok;
+}
+
+int main() {
+    int sizes[] = {4, 16, 64, 256};
+    static char line[16384];
+    struct Arena arena;
+    initArena(&arena);
+
+    if (!checkBackgroundList(&arena)) {
+        return 1;
+    }
+
+    for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+        buildLine(line, sizes[s]);
+        size_t length = strlen(line) + 1;
+
+        long allocations = 0;
+        double start = nowNs();
+        for (int i = 0; i < ITERATIONS; i++) {
+            long before = allocationCount;
+            char* work = arenaStrndup(&arena, line, length - 1);
+            int tokenCount;
+            struct Token* tokens = splitStringWithoutSpaces(&arena, work, &tokenCount);
+            parseCommandsFromWords(&arena, tokens, tokenCount);
+
+            resetArena(&arena);
+            allocations += allocationCount - before;
+        }
+        double elapsed = nowNs() - start;
+
+        printf("{\"bench\":\"tokenize_parse\",\"words\":%d,\"allocs_per_line\":%.2f,\"ns_per_line\":%.1f}\n",
+               sizes[s], (double)allocations / ITERATIONS, elapsed / ITERATIONS);
+    }
+
+    freeArena(&arena);
+    return 0;
+}
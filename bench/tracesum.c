@@ -0,0 +1,113 @@
+// Summary of a phase trace ('set -o trace-timing'): p50/p99 latency per phase.
+// Usage: bench/tracesum [trace-file] (default: stdin)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_PHASES 16
+#define PHASE_NAME_SIZE 32
+
+
+// Structure Phase (every duration recorded for one phase name)
+struct Phase {
+    char name[PHASE_NAME_SIZE];
+    long* durations;
+    long count;
+    long capacity;
+};
+
+static struct Phase phases[MAX_PHASES];
+static int phaseCount = 0;
+
+
+// Function to find a phase by name, added when missing. NULL when the table is full
+static struct Phase* findPhase(const char* name, size_t length) {
+    for (int i = 0; i < phaseCount; i++) {
+        if (strlen(phases[i].name) == length && strncmp(phases[i].name, name, length) == 0) {
+            return &phases[i];
+        }
+    }
+
+    if (phaseCount == MAX_PHASES || length >= PHASE_NAME_SIZE) {
+        return NULL;
+    }
+    struct Phase* phase = &phases[phaseCount++];
+    memcpy(phase->name, name, length);
+    phase->name[length] = '\0';
+    return phase;
+}
+
+static void addDuration(struct Phase* phase, long duration) {
+    if (phase->count == phase->capacity) {
+        phase->capacity = (phase->capacity == 0) ? 1024 : phase->capacity * 2;
+        phase->durations = (long*)realloc(phase->durations, phase->capacity * sizeof(long));
+        if (phase->durations == NULL) {
+            perror("Memory allocation");
+            exit(1);
+        }
+    }
+    phase->durations[phase->count++] = duration;
+}
+
+static int compareLong(const void* a, const void* b) {
+    long x = *(const long*)a;
+    long y = *(const long*)b;
+    return (x > y) - (x < y);
+}
+
+// Function to get a percentile of sorted durations (nearest rank)
+static long percentile(const struct Phase* phase, int percent) {
+    long rank = (phase->count * percent + 99) / 100;
+    return phase->durations[(rank > 0) ? rank - 1 : 0];
+}
+
+int main(int argc, char* argv[]) {
+    FILE* input = stdin;
+    if (argc > 1) {
+        input = fopen(argv[1], "r");
+        if (input == NULL) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    // Records look like {"cmd":1,"phase":"parse","pid":0,"start_ns":...,"dur_ns":...}
+    char line[512];
+    long skipped = 0;
+    while (fgets(line, sizeof(line), input) != NULL) {
+        char* name = strstr(line, "\"phase\":\"");
+        char* duration = strstr(line, "\"dur_ns\":");
+        if (name == NULL || duration == NULL) {
+            skipped++;
+            continue;
+        }
+
+        name += strlen("\"phase\":\"");
+        char* nameEnd = strchr(name, '"');
+        struct Phase* phase = (nameEnd != NULL) ? findPhase(name, nameEnd - name) : NULL;
+        if (phase == NULL) {
+            skipped++;
+            continue;
+        }
+        addDuration(phase, strtol(duration + strlen("\"dur_ns\":"), NULL, 10));
+    }
+
+    if (input != stdin) {
+        fclose(input);
+    }
+
+    printf("%-10s %10s %12s %12s %12s\n", "phase", "count", "p50(us)", "p99(us)", "max(us)");
+    for (int i = 0; i < phaseCount; i++) {
+        struct Phase* phase = &phases[i];
+        qsort(phase->durations, phase->count, sizeof(long), compareLong);
+        printf("%-10s %10ld %12.1f %12.1f %12.1f\n", phase->name, phase->count,
+               percentile(phase, 50) / 1e3, percentile(phase, 99) / 1e3,
+               phase->durations[phase->count - 1] / 1e3);
+        free(phase->durations);
+    }
+    if (skipped > 0) {
+        fprintf(stderr, "tracesum: %ld lines skipped\n", skipped);
+    }
+
+    return 0;
+}
@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bash_func.h"
+
+#define BUILTIN_TABLE_SIZE 64 // Power of two, at least twice the number of builtins
+
+
+static int exitStatusRequested = -1; // Set by 'exit'
+
+
+// Builtin wrappers: every one gets the whole command and returns an exit status
+
+static int builtinCd(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    return cd(cmd->words[1]);
+}
+
+static int builtinPwd(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    checkDirectory(); // It may have been moved or removed meanwhile
+    printf("%s\n", currentDirectory());
+    return 0;
+}
+
+static int builtinEcho(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    echo(cmd->words + 1);
+    return 0;
+}
+
+static int builtinHelp(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    help();
+    return 0;
+}
+
+static int builtinCache(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    printParseCacheStats();
+    return 0;
+}
+
+static int builtinHash(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    if (cmd->words[1] == NULL) {
+        printCommandPaths();
+        return 0;
+    }
+
+    int status = 0;
+    for (int i = 1; cmd->words[i] != NULL; i++) {
+        if (strcmp(cmd->words[i], "-r") == 0) {
+            clearCommandPaths();
+        } else if (strchr(cmd->words[i], '/') == NULL && !rememberCommandPath(cmd->words[i])) {
+            fprintf(stderr, "bash: hash: %s: not found\n", cmd->words[i]);
+            status = 1;
+        }
+    }
+    return status;
+}
+
+static int builtinHistory(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    if (cmd->words[1] != NULL && strcmp(cmd->words[1], "-c") == 0) {
+        clearHistory(historyList);
+    } else if (cmd->words[1] != NULL && strcmp(cmd->words[1], "--stats") == 0) {
+        printHistoryStats(*historyList);
+    } else if (cmd->words[1] != NULL && strcmp(cmd->words[1], "-s") == 0) {
+        if (cmd->words[2] == NULL) {
+            fprintf(stderr, "bash: history: -s: pattern required\n");
+            return 2;
+        }
+        return (printHistoryMatches(*historyList, cmd->words[2]) > 0) ? 0 : 1;
+    } else {
+        printHistory(*historyList);
+    }
+    return 0;
+}
+
+static int builtinExit(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    exitStatusRequested = (cmd->words[1] != NULL) ? atoi(cmd->words[1]) & 0xff : 0;
+    return exitStatusRequested;
+}
+
+static int builtinJobs(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    reapChildren(jobList, 0);
+    printJobs(*jobList);
+    return 0;
+}
+
+static int builtinFg(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    bringToForeground(jobList, cmd->words[1]);
+    return 0;
+}
+
+static int builtinBg(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    resumeInBackground(jobList, cmd->words[1]);
+    return 0;
+}
+
+static int builtinKill(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    if (cmd->words[1] == NULL || (cmd->words[2] == NULL && strcmp(cmd->words[1], "-l") != 0)) {
+        fprintf(stderr, "kill: usage: kill [-l] [signal | -g] [pid | -pgid]\n");
+        return 2;
+    }
+
+    char* identifier[2] = {cmd->words[1], cmd->words[2]};
+    killProcessByIdentifier(cmd, jobList, identifier);
+    return 0;
+}
+
+// set -o option / set +o option; 'set -o' alone lists the options
+static int builtinSet(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    if (cmd->words[1] == NULL || (strcmp(cmd->words[1], "-o") == 0 && cmd->words[2] == NULL)) {
+        printf("trace-timing\t%s\n", tracingEnabled() ? "on" : "off");
+        return 0;
+    }
+
+    if ((strcmp(cmd->words[1], "-o") != 0 && strcmp(cmd->words[1], "+o") != 0) || cmd->words[2] == NULL) {
+        fprintf(stderr, "bash: set: usage: set [-o|+o] option\n");
+        return 2;
+    }
+    if (strcmp(cmd->words[2], "trace-timing") != 0) {
+        fprintf(stderr, "bash: set: %s: invalid option name\n", cmd->words[2]);
+        return 1;
+    }
+
+    setTracing(cmd->words[1][0] == '-');
+    return 0;
+}
+
+// parallel [-j N] [command ...] [::: input ...]: default N is the number of CPUs
+static int builtinParallel(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    char** words = cmd->words + 1;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (*words != NULL && strncmp(*words, "-j", 2) == 0) {
+        const char* count = ((*words)[2] != '\0') ? *words + 2 : words[1];
+        char* end = NULL;
+        if (count != NULL) {
+            jobs = strtol(count, &end, 10);
+        }
+        if (count == NULL || *end != '\0') {
+            fprintf(stderr, "bash: parallel: usage: parallel [-j N] [command ...] [::: input ...]\n");
+            return 2;
+        }
+        words += ((*words)[2] != '\0') ? 1 : 2;
+    }
+
+    // Inputs after ':::', the prefix ends there
+    int prefixCount = 0;
+    while (words[prefixCount] != NULL && strcmp(words[prefixCount], ":::") != 0) {
+        prefixCount++;
+    }
+    char** arguments = (words[prefixCount] != NULL) ? words + prefixCount + 1 : NULL;
+
+    return runParallel(jobs, words, prefixCount, arguments, jobList, historyList);
+}
+
+static int builtinWait(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    if (cmd->words[1] != NULL && strcmp(cmd->words[1], "-n") == 0) {
+        return waitForJobs(jobList, cmd->words + 2, 1);
+    }
+    return waitForJobs(jobList, cmd->words + 1, 0);
+}
+
+
+static struct Builtin builtins[] = {
+    {"cd", builtinCd},
+    {"pwd", builtinPwd},
+    {"echo", builtinEcho},
+    {"help", builtinHelp},
+    {"cache", builtinCache},
+    {"hash", builtinHash},
+    {"history", builtinHistory},
+    {"exit", builtinExit},
+    {"jobs", builtinJobs},
+    {"fg", builtinFg},
+    {"bg", builtinBg},
+    {"kill", builtinKill},
+    {"wait", builtinWait},
+    {"set", builtinSet},
+    {"parallel", builtinParallel},
+};
+
+static struct Builtin* builtinTable[BUILTIN_TABLE_SIZE];
+static int builtinTableReady = 0;
+
+
+// Function to fill the open-addressing table once
+static void initBuiltinTable() {
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+        unsigned int slot = hashBytes(builtins[i].name, strlen(builtins[i].name)) & (BUILTIN_TABLE_SIZE - 1);
+        while (builtinTable[slot] != NULL) {
+            slot = (slot + 1) & (BUILTIN_TABLE_SIZE - 1);
+        }
+        builtinTable[slot] = &builtins[i];
+    }
+    builtinTableReady = 1;
+}
+
+// Function to find a builtin by name in constant time, returns NULL for external commands
+struct Builtin* findBuiltin(const char* name) {
+    if (!builtinTableReady) {
+        initBuiltinTable();
+    }
+
+    unsigned int slot = hashBytes(name, strlen(name)) & (BUILTIN_TABLE_SIZE - 1);
+    while (builtinTable[slot] != NULL) {
+        if (strcmp(builtinTable[slot]->name, name) == 0) {
+            return builtinTable[slot];
+        }
+        slot = (slot + 1) & (BUILTIN_TABLE_SIZE - 1);
+    }
+
+    return NULL;
+}
+
+// Function to run a builtin inside the shell process. Redirections are applied to the
+// shell's own stdin/stdout and restored afterwards
+int runBuiltin(struct Builtin* builtin, struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    int savedInput = -1;
+    int savedOutput = -1;
+    int status;
+
+    if (cmd->redirects != NULL) {
+        fflush(stdout);
+        savedInput = dup(STDIN_FILENO);
+        savedOutput = dup(STDOUT_FILENO);
+    }
+
+    if (applyRedirects(cmd) == -1) {
+        status = 1;
+    } else {
+        status = builtin->function(cmd, jobList, historyList);
+    }
+    fflush(stdout); // Nothing may stay buffered when the next child is forked
+
+    if (savedInput != -1) {
+        dup2(savedInput, STDIN_FILENO);
+        dup2(savedOutput, STDOUT_FILENO);
+        close(savedInput);
+        close(savedOutput);
+    }
+
+    return status;
+}
+
+// Function to get the status passed to 'exit', -1 while the shell keeps running
+int exitRequested() {
+    return exitStatusRequested;
+}
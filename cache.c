@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bash_func.h"
+
+#define PARSE_CACHE_SIZE 128       // Entries kept (least recently used is evicted)
+#define PARSE_CACHE_BUCKETS 256    // Hash buckets (power of two)
+#define PARSE_CACHE_MAX_LINE 4096  // Longer lines are not cached
+
+
+// Structure CacheEntry (one parsed line)
+struct CacheEntry {
+    unsigned long hash;       // Hash of the line
+    size_t length;            // Line length
+    struct Ast* ast;          // Immutable packed AST
+    struct CacheEntry* chain; // Next entry in the bucket
+    struct CacheEntry* prev;  // More recently used entry
+    struct CacheEntry* next;  // Less recently used entry
+    char line[];              // Raw input line
+};
+
+static struct CacheEntry* buckets[PARSE_CACHE_BUCKETS];
+static struct CacheEntry* mostRecent = NULL;
+static struct CacheEntry* leastRecent = NULL;
+static int entryCount = 0;
+static long cacheHits = 0;
+static long cacheMisses = 0;
+
+
+// Function to unlink an entry from the LRU list
+static void unlinkEntry(struct CacheEntry* entry) {
+    if (entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    } else {
+        mostRecent = entry->next;
+    }
+
+    if (entry->next != NULL) {
+        entry->next->prev = entry->prev;
+    } else {
+        leastRecent = entry->prev;
+    }
+}
+
+// Function to put an entry at the front of the LRU list
+static void pushFront(struct CacheEntry* entry) {
+    entry->prev = NULL;
+    entry->next = mostRecent;
+    if (mostRecent != NULL) {
+        mostRecent->prev = entry;
+    }
+    mostRecent = entry;
+
+    if (leastRecent == NULL) {
+        leastRecent = entry;
+    }
+}
+
+// Function to remove and free the least recently used entry
+static void evictLeastRecent() {
+    struct CacheEntry* entry = leastRecent;
+    unlinkEntry(entry);
+
+    struct CacheEntry** link = &buckets[entry->hash & (PARSE_CACHE_BUCKETS - 1)];
+    while (*link != entry) {
+        link = &(*link)->chain;
+    }
+    *link = entry->chain;
+
+    free(entry->ast);
+    free(entry);
+    entryCount--;
+}
+
+// Function to find the parsed form of a line, returns NULL on a miss
+struct Ast* lookupParseCache(const char* line, size_t length) {
+    unsigned long hash = hashBytes(line, length);
+
+    for (struct CacheEntry* entry = buckets[hash & (PARSE_CACHE_BUCKETS - 1)]; entry != NULL; entry = entry->chain) {
+        if (entry->hash == hash && entry->length == length && memcmp(entry->line, line, length) == 0) {
+            if (entry != mostRecent) {
+                unlinkEntry(entry);
+                pushFront(entry);
+            }
+            cacheHits++;
+            return entry->ast;
+        }
+    }
+
+    cacheMisses++;
+    return NULL;
+}
+
+// Function to store a copy of the parsed line, returns the cached copy
+// (or ast itself when the line is too long to be cached)
+struct Ast* storeParseCache(const char* line, size_t length, const struct Ast* ast) {
+    if (length > PARSE_CACHE_MAX_LINE) {
+        return (struct Ast*)ast;
+    }
+
+    if (entryCount >= PARSE_CACHE_SIZE) {
+        evictLeastRecent();
+    }
+
+    struct CacheEntry* entry = (struct CacheEntry*)malloc(sizeof(struct CacheEntry) + length + 1);
+    if (entry == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+
+    entry->hash = hashBytes(line, length);
+    entry->length = length;
+    entry->ast = copyAst(ast);
+    memcpy(entry->line, line, length);
+    entry->line[length] = '\0';
+
+    struct CacheEntry** bucket = &buckets[entry->hash & (PARSE_CACHE_BUCKETS - 1)];
+    entry->chain = *bucket;
+    *bucket = entry;
+    pushFront(entry);
+    entryCount++;
+
+    return entry->ast;
+}
+
+// cache: print the parse cache counters
+void printParseCacheStats() {
+    long lookups = cacheHits + cacheMisses;
+
+    printf("hits: %ld\n", cacheHits);
+    printf("misses: %ld\n", cacheMisses);
+    printf("hit rate: %.1f%%\n", (lookups > 0) ? 100.0 * cacheHits / lookups : 0.0);
+    printf("entries: %d/%d\n", entryCount, PARSE_CACHE_SIZE);
+}
+
+// Function to free every cached line
+void clearParseCache() {
+    while (leastRecent != NULL) {
+        evictLeastRecent();
+    }
+}
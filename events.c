@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/pidfd.h>
+#include <unistd.h>
+
+#include "bash_func.h"
+
+#define MAX_EVENTS 64
+#define PIDFD_TAG (1ULL << 32) // Above every descriptor number
+
+
+static int epollFd = -1; // Watches the SIGCHLD signalfd, every job's pidfd and (at the prompt) stdin
+
+
+// Function to add a descriptor to the watched set; tag tells the events apart:
+// a descriptor number, or PIDFD_TAG plus the pid of a job
+static void watchFd(int fd, uint64_t tag) {
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u64 = tag;
+
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+        perror("epoll_ctl");
+    }
+}
+
+// Function to create the event loop, after initChildSignals()
+void initEventLoop() {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd == -1) {
+        perror("epoll_create1");
+        return;
+    }
+
+    if (childEventFd() != -1) {
+        watchFd(childEventFd(), childEventFd());
+    }
+}
+
+// Function to drop the event loop in a forked child, so it cannot change the shell's watched set
+void closeEventLoop() {
+    if (epollFd != -1) {
+        close(epollFd);
+        epollFd = -1;
+    }
+}
+
+// Function to get a pidfd for a new job and watch it. Returns -1 when pidfds are not available
+int watchProcess(pid_t pid) {
+    int pidfd = pidfd_open(pid, 0);
+    if (pidfd != -1 && epollFd != -1) {
+        watchFd(pidfd, PIDFD_TAG | (uint64_t)pid);
+    }
+    return pidfd;
+}
+
+// Function to stop watching a job's pidfd and close it. The epoll entry is removed
+// first: it lives as long as any copy of the pidfd, so closing alone may leave it
+// readable forever
+void unwatchProcess(int pidfd) {
+    if (epollFd != -1) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, pidfd, NULL);
+    }
+    close(pidfd);
+}
+
+// Function to send a signal to a job through its pidfd, so a reused pid is never hit
+int signalProcess(struct Job* job, int sig) {
+    if (job->pidfd != -1) {
+        return pidfd_send_signal(job->pidfd, sig, NULL, 0);
+    }
+    return kill(job->pid, sig);
+}
+
+// Function to block until something happens and handle it: jobs whose process ended are
+// reported and removed, other child state changes go through reapChildren().
+// watchInput: also wake up for terminal input, notices then start on a new line.
+// Returns 1 when the terminal has input, -1 when waiting failed, 0 otherwise
+int waitForEvents(struct Job** jobList, int watchInput, int* notices) {
+    if (epollFd == -1) {
+        return -1;
+    }
+
+    if (watchInput) {
+        watchFd(STDIN_FILENO, STDIN_FILENO);
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    int count = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+    int result = 0;
+
+    if (watchInput) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+    }
+
+    if (count == -1) {
+        return (errno == EINTR) ? 0 : -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        uint64_t tag = events[i].data.u64;
+
+        if (tag == STDIN_FILENO && watchInput) {
+            result = 1;
+        } else if (tag == (uint64_t)childEventFd()) {
+            *notices += reapChildren(jobList, watchInput && *notices == 0);
+        } else {
+            // The job's main process ended; it may already be gone if an earlier event reaped it
+            struct Job* job = findJobByProcess(*jobList, (pid_t)(tag & ~PIDFD_TAG));
+            int status;
+            if (job != NULL && waitpid(job->pid, &status, WNOHANG) == job->pid) {
+                *notices += updateProcess(jobList, job->pid, status, watchInput && *notices == 0);
+            } else if (job != NULL && job->pidfd != -1) {
+                // Reaped elsewhere: a pidfd left in the set would stay readable
+                unwatchProcess(job->pidfd);
+                job->pidfd = -1;
+            }
+        }
+    }
+
+    return result;
+}
+
+// Function to check whether a job still has to be waited for: running, not stopped
+static int stillRunning(struct Job* jobList, pid_t pid) {
+    struct Job* job = findJobByProcess(jobList, pid);
+    return job != NULL && job->state != 1;
+}
+
+// Function to check whether any job is running (stopped jobs never finish by themselves)
+static int runningJobs(struct Job* jobList) {
+    for (struct Job* job = jobList; job != NULL; job = job->next) {
+        if (job->state != 1) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Function for 'wait': with no pids wait for every running job, with pids for those jobs,
+// with any set for the next job to finish. Returns the status of the last job that ended,
+// 0 without pids
+int waitForJobs(struct Job** jobList, char** pids, int any) {
+    int count = 0;
+    while (pids[count] != NULL) {
+        count++;
+    }
+
+    pid_t* targets = (pid_t*)malloc((count + 1) * sizeof(pid_t));
+    if (targets == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+
+    int status = 0;
+    for (int i = 0; i < count; i++) {
+        struct Job* job = findJobByPid(*jobList, pids[i]);
+        if (job == NULL) {
+            fprintf(stderr, "bash: wait: %s: no such job\n", pids[i]);
+            status = 127;
+            targets[i] = 0;
+        } else {
+            targets[i] = job->pid;
+        }
+    }
+
+    long finishedBefore = finishedJobCount();
+
+    while (1) {
+        int waiting;
+        if (any) {
+            waiting = (finishedJobCount() == finishedBefore) && runningJobs(*jobList);
+        } else if (count == 0) {
+            waiting = runningJobs(*jobList);
+        } else {
+            waiting = 0;
+            for (int i = 0; i < count && !waiting; i++) {
+                waiting = (targets[i] != 0 && stillRunning(*jobList, targets[i]));
+            }
+        }
+
+        if (!waiting) {
+            break;
+        }
+
+        int notices = 0;
+        if (waitForEvents(jobList, 0, &notices) == -1) {
+            perror("epoll_wait");
+            break;
+        }
+    }
+
+    // A plain 'wait' returns 0 whatever the jobs returned
+    if (status == 0 && (any || count > 0) && finishedJobCount() != finishedBefore) {
+        status = lastFinishedStatus();
+    }
+
+    free(targets);
+    return status;
+}
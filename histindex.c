@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bash_func.h"
+
+#define TRIGRAM_BUCKETS 65536 // Hash buckets (power of two)
+#define MIN_POSTINGS 16       // First size of a posting list
+
+
+// Structure Trigram (every history entry that contains three given bytes; also used for
+// one and two bytes, so short patterns are looked up the same way)
+struct Trigram {
+    unsigned int key;        // The bytes, see trigramKey() and shortKey()
+    unsigned int* numbers;   // History numbers, ascending
+    int head;                // Numbers before head were dropped from history
+    int count;
+    int capacity;
+    struct Trigram* chain;   // Next trigram in the bucket
+};
+
+// Trigram index over the history ring, one per shell. It is updated as entries are
+// added, entries that fall out of the ring are skipped and trimmed lazily
+static struct Trigram** buckets = NULL;
+
+
+// Function to get the key of the three bytes at text
+static unsigned int trigramKey(const char* text) {
+    return ((unsigned int)(unsigned char)text[0] << 16) |
+           ((unsigned int)(unsigned char)text[1] << 8) |
+           (unsigned int)(unsigned char)text[2];
+}
+
+// Function to get the key of a one or two byte string, apart from every trigram key
+static unsigned int shortKey(const char* text, size_t length) {
+    unsigned int key = (unsigned int)(unsigned char)text[0];
+    if (length == 2) {
+        key = key << 8 | (unsigned int)(unsigned char)text[1];
+    }
+    return (unsigned int)length << 24 | key;
+}
+
+static unsigned int bucketOf(unsigned int key) {
+    return (key * 2654435761u) >> 16 & (TRIGRAM_BUCKETS - 1);
+}
+
+// Function to find the posting list of a trigram, NULL when no entry has it
+static struct Trigram* findTrigram(unsigned int key) {
+    if (buckets == NULL) {
+        return NULL;
+    }
+
+    for (struct Trigram* trigram = buckets[bucketOf(key)]; trigram != NULL; trigram = trigram->chain) {
+        if (trigram->key == key) {
+            return trigram;
+        }
+    }
+    return NULL;
+}
+
+// Function to get the posting list of a trigram, created when missing
+static struct Trigram* addTrigram(unsigned int key) {
+    struct Trigram* trigram = findTrigram(key);
+    if (trigram != NULL) {
+        return trigram;
+    }
+
+    trigram = (struct Trigram*)malloc(sizeof(struct Trigram));
+    if (trigram == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+
+    trigram->key = key;
+    trigram->numbers = NULL;
+    trigram->head = 0;
+    trigram->count = 0;
+    trigram->capacity = 0;
+    trigram->chain = buckets[bucketOf(key)];
+    buckets[bucketOf(key)] = trigram;
+
+    return trigram;
+}
+
+// Function to append a history number to a posting list; numbers below oldest are gone
+// from history and dropped from the front first
+static void addPosting(struct Trigram* trigram, unsigned int number, unsigned int oldest) {
+    while (trigram->head < trigram->count && trigram->numbers[trigram->head] < oldest) {
+        trigram->head++;
+    }
+    if (trigram->head > MIN_POSTINGS && trigram->head > trigram->count / 2) {
+        trigram->count -= trigram->head;
+        memmove(trigram->numbers, trigram->numbers + trigram->head, trigram->count * sizeof(unsigned int));
+        trigram->head = 0;
+    }
+
+    if (trigram->count == trigram->capacity) {
+        trigram->capacity = (trigram->capacity == 0) ? MIN_POSTINGS : trigram->capacity * 2;
+        trigram->numbers = (unsigned int*)realloc(trigram->numbers, trigram->capacity * sizeof(unsigned int));
+        if (trigram->numbers == NULL) {
+            perror("Memory allocation");
+            exit(1);
+        }
+    }
+
+    trigram->numbers[trigram->count++] = number;
+}
+
+// Function to list a history entry under a key once, however often the entry has it
+static void indexKey(unsigned int key, unsigned int number, unsigned int oldest) {
+    struct Trigram* trigram = addTrigram(key);
+    if (trigram->count == 0 || trigram->numbers[trigram->count - 1] != number) {
+        addPosting(trigram, number, oldest);
+    }
+}
+
+// Function to index a history entry under each of its trigrams, bigrams and bytes.
+// oldest: number of the oldest entry still in history
+void indexHistoryEntry(unsigned int number, const char* command, size_t length, unsigned int oldest) {
+    if (buckets == NULL) {
+        buckets = (struct Trigram**)calloc(TRIGRAM_BUCKETS, sizeof(struct Trigram*));
+        if (buckets == NULL) {
+            perror("Memory allocation");
+            exit(1);
+        }
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        indexKey(shortKey(command + i, 1), number, oldest);
+        if (i + 2 <= length) {
+            indexKey(shortKey(command + i, 2), number, oldest);
+        }
+        if (i + 3 <= length) {
+            indexKey(trigramKey(command + i), number, oldest);
+        }
+    }
+}
+
+// Function to drop the whole index
+void clearHistoryIndex() {
+    if (buckets == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < TRIGRAM_BUCKETS; i++) {
+        struct Trigram* trigram = buckets[i];
+        while (trigram != NULL) {
+            struct Trigram* next = trigram->chain;
+            free(trigram->numbers);
+            free(trigram);
+            trigram = next;
+        }
+    }
+
+    free(buckets);
+    buckets = NULL;
+}
+
+// Function to find the newest entry before the history number 'before' that contains
+// pattern. Only the entries listed for the pattern's rarest trigram are looked at; a
+// pattern of one or two bytes has its own list, whose newest fitting entry is the match.
+// Returns the entry's number, or -1 when there is none
+long searchHistory(const struct History* history, const char* pattern, long before) {
+    size_t length = strlen(pattern);
+    if (history == NULL || length == 0) {
+        return -1;
+    }
+
+    long newest = history->number + history->count;
+    if (before > newest) {
+        before = newest;
+    }
+
+    // Every match is in the posting list of each trigram, use the shortest
+    struct Trigram* rarest = NULL;
+    if (length < 3) {
+        rarest = findTrigram(shortKey(pattern, length));
+        if (rarest == NULL) {
+            return -1;
+        }
+    }
+    for (size_t i = 0; i + 3 <= length; i++) {
+        struct Trigram* trigram = findTrigram(trigramKey(pattern + i));
+        if (trigram == NULL) {
+            return -1;
+        }
+        if (rarest == NULL || trigram->count - trigram->head < rarest->count - rarest->head) {
+            rarest = trigram;
+        }
+    }
+
+    // Binary search for the first number at or after 'before', then walk back
+    int low = rarest->head;
+    int high = rarest->count;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (rarest->numbers[middle] < before) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    for (int i = low - 1; i >= rarest->head && rarest->numbers[i] >= history->number; i--) {
+        if (strstr(historyEntry(history, rarest->numbers[i]), pattern) != NULL) {
+            return rarest->numbers[i];
+        }
+    }
+    return -1;
+}
@@ -1,78 +1,453 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/file.h>
 
 #include "bash_func.h"
 
-#define MAX_HISTORY_SIZE 256
+#define DEFAULT_HISTORY_SIZE 1000           // Entries kept when HISTSIZE is not set
+#define DEFAULT_HISTORY_FILE ".bash_history" // In $HOME when HISTFILE is not set
+#define MIN_TEXT_BUCKETS 256                 // Buckets of the interned commands at first (power of two)
+#define STATS_TOP 10                         // Commands listed by 'history --stats'
 
 
-// Function to create a new history node
-struct History* createHistoryNode(char* command) {
-    struct History* newNode = (struct History*)malloc(sizeof(struct History));
-    if (newNode == NULL) {
+// Structure HistoryText (one distinct command line, shared by all its entries)
+struct HistoryText {
+    unsigned int hash;         // Hash of the text
+    int uses;                  // Entries that refer to it
+    struct HistoryText* chain; // Next text in the bucket
+    char text[];
+};
+
+// Interned command lines of the history ring, one set per shell
+static struct HistoryText** textBuckets = NULL;
+static unsigned int textBucketCount = 0;
+static unsigned int textCount = 0;
+
+
+// Function to double the buckets of the interned commands and put every text back
+static void growTexts() {
+    unsigned int oldCount = textBucketCount;
+    struct HistoryText** old = textBuckets;
+
+    textBucketCount = (oldCount == 0) ? MIN_TEXT_BUCKETS : oldCount * 2;
+    textBuckets = (struct HistoryText**)calloc(textBucketCount, sizeof(struct HistoryText*));
+    if (textBuckets == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+
+    for (unsigned int i = 0; i < oldCount; i++) {
+        struct HistoryText* text = old[i];
+        while (text != NULL) {
+            struct HistoryText* next = text->chain;
+            unsigned int slot = text->hash & (textBucketCount - 1);
+            text->chain = textBuckets[slot];
+            textBuckets[slot] = text;
+            text = next;
+        }
+    }
+    free(old);
+}
+
+// Function to get the shared copy of a command line, stored the first time it is seen
+static struct HistoryText* internText(const char* command, size_t length) {
+    unsigned int hash = hashBytes(command, length);
+
+    if (textBucketCount != 0) {
+        struct HistoryText* text = textBuckets[hash & (textBucketCount - 1)];
+        for (; text != NULL; text = text->chain) {
+            if (text->hash == hash && strncmp(text->text, command, length) == 0 && text->text[length] == '\0') {
+                text->uses++;
+                return text;
+            }
+        }
+    }
+
+    if (textCount >= textBucketCount) {
+        growTexts();
+    }
+
+    struct HistoryText* text = (struct HistoryText*)malloc(sizeof(struct HistoryText) + length + 1);
+    if (text == NULL) {
         perror("Memory allocation");
         exit(1);
     }
 
-    newNode->command = strdup(command);
-    newNode->next = NULL;
+    text->hash = hash;
+    text->uses = 1;
+    memcpy(text->text, command, length);
+    text->text[length] = '\0';
+
+    unsigned int slot = hash & (textBucketCount - 1);
+    text->chain = textBuckets[slot];
+    textBuckets[slot] = text;
+    textCount++;
+
+    return text;
+}
+
+// Function to drop an entry's reference to its text, the last one frees it
+static void releaseText(struct HistoryText* text) {
+    if (--text->uses > 0) {
+        return;
+    }
 
-    return newNode;
+    struct HistoryText** link = &textBuckets[text->hash & (textBucketCount - 1)];
+    while (*link != text) {
+        link = &(*link)->chain;
+    }
+    *link = text->chain;
+    textCount--;
+    free(text);
 }
 
-// Function to add a command to history
+
+// Function to create an empty history ring for size entries
+static struct History* createHistory(int size) {
+    struct History* history = (struct History*)malloc(sizeof(struct History));
+    if (history == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+
+    history->entries = (struct HistoryEntry*)calloc(size, sizeof(struct HistoryEntry));
+    if (history->entries == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+
+    history->capacity = size;
+    history->start = 0;
+    history->count = 0;
+    history->number = 1;
+    history->fd = -1;
+
+    return history;
+}
+
+// Function to get the number of entries to keep (HISTSIZE)
+static int historySize() {
+    const char* size = getenv("HISTSIZE");
+    int value = (size != NULL) ? atoi(size) : 0;
+    return (value > 0) ? value : DEFAULT_HISTORY_SIZE;
+}
+
+// Function to get the i-th kept entry, 0 is the oldest
+static struct HistoryEntry* entryAt(const struct History* history, int i) {
+    return &history->entries[(history->start + i) % history->capacity];
+}
+
+// Function to put a command into the ring; when it is full the oldest entry is dropped.
+// started: start time, 0 when not known
+static void pushHistory(struct History* history, const char* command, size_t length, time_t started) {
+    struct HistoryText* text = internText(command, length);
+
+    struct HistoryEntry* entry;
+    if (history->count == history->capacity) {
+        entry = entryAt(history, 0);
+        releaseText(entry->text);
+        history->start = (history->start + 1) % history->capacity;
+        history->number++;
+    } else {
+        history->count++;
+        entry = entryAt(history, history->count - 1);
+    }
+
+    entry->text = text;
+    entry->started = started;
+    entry->wallUs = -1;
+    entry->cpuUs = 0;
+    entry->status = 0;
+
+    indexHistoryEntry(history->number + history->count - 1, text->text, length, history->number);
+}
+
+// Function to get the command with a history number, NULL when it is not kept
+const char* historyEntry(const struct History* history, long number) {
+    if (history == NULL || number < history->number || number >= history->number + history->count) {
+        return NULL;
+    }
+    return entryAt(history, number - history->number)->text->text;
+}
+
+// Function to record how the newest command went, after it ran
+void finishHistoryEntry(struct History* history, int status, long wallUs, long cpuUs) {
+    if (history == NULL || history->count == 0) {
+        return;
+    }
+
+    struct HistoryEntry* entry = entryAt(history, history->count - 1);
+    entry->status = status;
+    entry->wallUs = wallUs;
+    entry->cpuUs = cpuUs;
+}
+
+// Function to add a command to history, and to the history file with one append
 void addToHistory(struct History** historyList, char* command) {
-    struct History* newNode = createHistoryNode(command);
-    newNode->next = *historyList;
-    *historyList = newNode;
+    if (*historyList == NULL) {
+        *historyList = createHistory(historySize());
+    }
+
+    struct History* history = *historyList;
+    size_t length = strlen(command);
+    pushHistory(history, command, length, time(NULL));
+
+    if (history->fd != -1) {
+        // One write per command: O_APPEND keeps lines of several shells whole, the shared
+        // lock keeps them out of a trim in progress
+        struct iovec parts[2] = {{command, length}, {"\n", 1}};
+        flock(history->fd, LOCK_SH);
+        ssize_t written = writev(history->fd, parts, 2);
+        flock(history->fd, LOCK_UN);
+
+        if (written != (ssize_t)length + 1) {
+            perror("history");
+            close(history->fd);
+            history->fd = -1;
+        }
+    }
 }
 
-// Function to print command history
+// Function to find where the last size lines of a buffer start
+static size_t lastLines(const char* data, size_t size, int lines) {
+    size_t offset = size;
+    if (offset > 0 && data[offset - 1] == '\n') {
+        offset--;
+    }
+
+    while (offset > 0) {
+        if (data[offset - 1] == '\n' && --lines == 0) {
+            break;
+        }
+        offset--;
+    }
+    return offset;
+}
+
+// Function to copy size bytes inside a file, returns 0 when every byte was moved
+static int copyFileRange(int fd, off_t from, off_t to, size_t size) {
+    char* buffer = (char*)malloc(size);
+    if (buffer == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+
+    size_t done = 0;
+    while (done < size) {
+        ssize_t count = pread(fd, buffer + done, size - done, from + done);
+        if (count <= 0) {
+            break;
+        }
+        done += count;
+    }
+
+    size_t written = 0;
+    while (done == size && written < size) {
+        ssize_t count = pwrite(fd, buffer + written, size - written, to + written);
+        if (count <= 0) {
+            break;
+        }
+        written += count;
+    }
+
+    free(buffer);
+    return (written == size) ? 0 : -1;
+}
+
+// Function to cut the history file down to its lines from start on. It is done in place
+// under an exclusive lock: other shells keep appending to the same file (they take a
+// shared lock per line), and lines they added since it was read are kept
+static void trimHistoryFile(int fd, size_t start) {
+    if (flock(fd, LOCK_EX) == -1) {
+        return; // Keep the long file, it is trimmed next time
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size > start) {
+        size_t size = st.st_size - start;
+        if (copyFileRange(fd, start, 0, size) == 0) {
+            ftruncate(fd, size);
+        }
+    }
+
+    flock(fd, LOCK_UN);
+}
+
+// Function to load the last HISTSIZE commands of the history file (HISTFILE, default
+// ~/.bash_history) with a single mmap and keep it open, so new commands are appended.
+// The file is trimmed when most of it is older than what is kept
+void loadHistory(struct History** historyList) {
+    char path[4096];
+    const char* file = getenv("HISTFILE");
+    if (file != NULL) {
+        if (file[0] == '\0') {
+            return; // HISTFILE= turns saving off
+        }
+        snprintf(path, sizeof(path), "%s", file);
+    } else if (getenv("HOME") != NULL) {
+        snprintf(path, sizeof(path), "%s/%s", getenv("HOME"), DEFAULT_HISTORY_FILE);
+    } else {
+        return;
+    }
+
+    if (*historyList == NULL) {
+        *historyList = createHistory(historySize());
+    }
+    struct History* history = *historyList;
+
+    // Not O_APPEND: a trim writes at the start
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd != -1) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            char* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                size_t start = lastLines(data, st.st_size, history->capacity);
+
+                for (size_t offset = start; offset < (size_t)st.st_size;) {
+                    const char* end = memchr(data + offset, '\n', st.st_size - offset);
+                    size_t length = (end != NULL) ? (size_t)(end - data) - offset : st.st_size - offset;
+                    if (length > 0) {
+                        pushHistory(history, data + offset, length, 0);
+                    }
+                    offset += length + 1;
+                }
+
+                munmap(data, st.st_size);
+                if (start > (size_t)st.st_size / 2) {
+                    trimHistoryFile(fd, start);
+                }
+            }
+        }
+        close(fd);
+    }
+
+    history->fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+}
+
+// Function to print command history, numbered from the first command of the session
+// or file that is still kept
 void printHistory(const struct History* historyList) {
-    int count = 1;
-    const struct History* current = historyList;
-    const struct History* historyArray[MAX_HISTORY_SIZE];
-    
-    int index = 0;
-    while (current != NULL) {
-        historyArray[index] = current;
-        current = current->next;
-        index++;
+    if (historyList == NULL) {
+        return;
     }
-    
-    for (int i = index - 1; i >= 0; i--) {
-    	printf("%d: %s\n", count, historyArray[i]->command);
-    	count++;
+
+    for (int i = 0; i < historyList->count; i++) {
+        printf("%ld: %s\n", historyList->number + i, entryAt(historyList, i)->text->text);
     }
 }
 
 
-// Function to free memory allocated for history
+// Function to free memory allocated for history and close the history file
 void freeHistory(struct History* historyList) {
-    struct History* current = historyList;
-    struct History* next;
+    if (historyList == NULL) {
+        return;
+    }
 
-    while (current != NULL) {
-        next = current->next;
-        free(current->command);
-        free(current);
-        current = next;
+    clearHistory(&historyList);
+    if (historyList->fd != -1) {
+        close(historyList->fd);
     }
+    free(historyList->entries);
+    free(historyList);
 }
 
-void freeHistoryNode(struct History** historyNode) {
-	if (*historyNode != NULL) {
-		struct History* temp = *historyNode;
-		free(temp->command);
-		free(temp);
-	}
-	
-	*historyNode = NULL;
+// Function to clear command history (the history file is kept)
+void clearHistory(struct History** historyList) {
+    struct History* history = *historyList;
+    if (history == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < history->count; i++) {
+        releaseText(entryAt(history, i)->text);
+    }
+    history->number += history->count;
+    history->start = 0;
+    history->count = 0;
+    clearHistoryIndex();
 }
 
-// Function to clear command history
-void clearHistory(struct History** historyList) {
-    freeHistory(*historyList);
-    *historyList = NULL;
+// Function to print the commands that contain pattern, most recent first ('history -s')
+int printHistoryMatches(const struct History* historyList, const char* pattern) {
+    int found = 0;
+    long number = searchHistory(historyList, pattern, LONG_MAX);
+
+    while (number != -1) {
+        printf("%ld: %s\n", number, historyEntry(historyList, number));
+        found++;
+        number = searchHistory(historyList, pattern, number);
+    }
+    return found;
+}
+
+
+// qsort order: slowest entries first
+static int bySlowest(const void* a, const void* b) {
+    long left = (*(const struct HistoryEntry* const*)a)->wallUs;
+    long right = (*(const struct HistoryEntry* const*)b)->wallUs;
+    return (left < right) - (left > right);
+}
+
+// qsort order: most used commands first
+static int byMostUsed(const void* a, const void* b) {
+    int left = (*(const struct HistoryText* const*)a)->uses;
+    int right = (*(const struct HistoryText* const*)b)->uses;
+    return (left < right) - (left > right);
+}
+
+// Function for 'history --stats': the slowest timed commands with their start time,
+// CPU time and status, then the most frequent command lines
+void printHistoryStats(const struct History* historyList) {
+    if (historyList == NULL || historyList->count == 0) {
+        return;
+    }
+
+    const struct HistoryEntry** timed = (const struct HistoryEntry**)malloc(historyList->count * sizeof(struct HistoryEntry*));
+    const struct HistoryText** texts = (const struct HistoryText**)malloc(textCount * sizeof(struct HistoryText*));
+    if (timed == NULL || texts == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+
+    int timedCount = 0;
+    for (int i = 0; i < historyList->count; i++) {
+        if (entryAt(historyList, i)->wallUs >= 0) {
+            timed[timedCount++] = entryAt(historyList, i);
+        }
+    }
+    qsort(timed, timedCount, sizeof(timed[0]), bySlowest);
+
+    printf("Slowest commands:\n");
+    printf("%10s %10s %6s  %-19s  %s\n", "wall(s)", "cpu(s)", "status", "started", "command");
+    for (int i = 0; i < timedCount && i < STATS_TOP; i++) {
+        char started[32];
+        strftime(started, sizeof(started), "%Y-%m-%d %H:%M:%S", localtime(&timed[i]->started));
+        printf("%10.3f %10.3f %6d  %-19s  %s\n", timed[i]->wallUs / 1e6, timed[i]->cpuUs / 1e6,
+               timed[i]->status, started, timed[i]->text->text);
+    }
+
+    int textIndex = 0;
+    for (unsigned int i = 0; i < textBucketCount; i++) {
+        for (const struct HistoryText* text = textBuckets[i]; text != NULL; text = text->chain) {
+            texts[textIndex++] = text;
+        }
+    }
+    qsort(texts, textIndex, sizeof(texts[0]), byMostUsed);
+
+    printf("\nMost frequent commands (%d entries, %u distinct):\n", historyList->count, textCount);
+    for (int i = 0; i < textIndex && i < STATS_TOP; i++) {
+        printf("%10d  %s\n", texts[i]->uses, texts[i]->text);
+    }
+
+    free(timed);
+    free(texts);
 }
@@ -1,455 +1,373 @@
+#define _GNU_SOURCE // pipe2
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <unistd.h>
 #include <signal.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <sys/signalfd.h>
 
 #include "bash_func.h"
 
 
-void clearJobs(struct Job** jobList); 
+static int childSignalFd = -1; // SIGCHLD notifications (signalfd)
+static long jobsFinished = 0;   // Jobs reported as ended so far
+static int lastJobStatus = 0;   // Exit status of the last of them
+static long foregroundCpu = 0;  // CPU time of reaped foreground children (microseconds)
 
-// Function for creating a new Job
-struct Job* createJob(pid_t pid, pid_t pgid, char* command, int state, struct Command* commands) {
-    struct Job* job = (struct Job*)malloc(sizeof(struct Job));
-    if (job == NULL) {
-        perror("Memory allocation");
-        clearJobs(&job);
-        return NULL;
+// Function to count the stages of a pipeline
+static int stageCount(struct Command* cmd) {
+    int count = 0;
+    for (; cmd != NULL; cmd = cmd->next) {
+        count++;
     }
-
-    job->pid = pid;
-    job->pgid = pgid;
-    job->command = strdup(command);
-    job->state = state;
-    job->commands = commands;
-    job->next = NULL;
-
-    return job;
+    return count;
 }
 
-// Function for adding a Job to the list
-void addJob(struct Job** jobList, struct Job* newJob) {
-    if (*jobList == NULL) {
-        *jobList = newJob;
-    } else {
-        struct Job* current = *jobList;
-        while (current->next != NULL) {
-            current = current->next;
-        }
-        current->next = newJob;
-    }
+// Function to describe a freshly started process
+static struct Process startedProcess(pid_t pid) {
+    struct Process process;
+    process.pid = pid;
+    process.state = 0;
+    process.status = 0;
+    process.job = NULL;
+    process.chain = NULL;
+    return process;
 }
 
 
-void executeInBackground(struct Command* cmd, struct Job** jobList) {
+void executeInBackground(struct Command* cmd, struct Job** jobList, struct History** historyList) {
     if (cmd == NULL) {
         return;
     }
 
-    pid_t pid = fork();
-    if (pid == -1) {
-        perror("fork");
-        exit(EXIT_FAILURE);
-    } else if (pid == 0) {
-        // Child process
-        
-        signal(SIGINT, SIG_DFL);
-        signal(SIGTSTP, SIG_DFL);
-        signal(SIGTERM, SIG_DFL);
-        signal(SIGQUIT, SIG_DFL);
-        signal(SIGHUP, SIG_DFL);
-        signal(SIGKILL, SIG_DFL);
-        setpgid(0, 0);
-        execvp(cmd->words[0], cmd->words);
-        perror("execvp");
-        exit(EXIT_FAILURE);
-    } else {
-    	cmd->pid = pid;
-    	printf("Process with id [%d]\n", pid);
-    	    	
-    	struct Job* job = createJob(pid, pid, cmd->words[0], 0, cmd);
-    	
-    	addJob(jobList, job);
-
-
-        // Return control of the terminal to the parent process
-       	tcsetpgrp(STDIN_FILENO, getpgrp());
+    pid_t pid = spawnCommand(cmd, 0, -1, -1, -1, -1, jobList, historyList);
+    if (pid < 0) {
+        return;
     }
-}
 
+    printf("Process with id [%d]\n", pid);
 
-void executeDefault(struct Command* cmd, struct Job** jobList, struct History** historyList) {
-    if (cmd == NULL) {
-        return;
-    }
+    struct Process process = startedProcess(pid);
+    addJob(jobList, createJob(pid, &process, 1, 0, cmd));
 
-    pid_t pid = fork();
-    if (pid == -1) {
-        perror("fork");
-        exit(EXIT_FAILURE);
-    } else if (pid == 0) {
-        signal(SIGTSTP, SIG_DFL);
-        signal(SIGINT, SIG_DFL);
-        signal(SIGQUIT, SIG_DFL);
-        signal(SIGTERM, SIG_DFL);
-        signal(SIGCONT, SIG_DFL);
-        signal(SIGHUP, SIG_DFL);
-        signal(SIGKILL, SIG_DFL);
-        cmd->pid = pid;
-        execvp(cmd->words[0], cmd->words);
-        perror("execvp");
-        freeCommand(&cmd);
-        clearHistory(historyList);
-        exit(EXIT_FAILURE);
-    } else {
-        int status;
-        setpgid(0, 0);
-        waitpid(pid, &status, WUNTRACED);
-
-        if (WIFEXITED(status)) {
-            // Process exited successfully
-            
-        } else if (WIFSTOPPED(status)) {
-            // CTRL + Z pushed
-            printf("\n[%d] %s Stopped\n", pid, cmd->words[0]);
-            struct Job* job = createJob(pid, pid, cmd->words[0], 1, cmd);
-            addJob(jobList, job);
-        } else {
-            printf("\n%s: execution error\n", cmd->words[0]);
-        }
-    }
+    // Return control of the terminal to the parent process
+    tcsetpgrp(STDIN_FILENO, getpgrp());
 }
 
 
-void executePipeline(struct Command* cmd, struct Job** jobList) {
-    int fd[2];
-    int prev_fd = 0;
+// Function to convert a wait status into a shell exit status
+static int exitStatus(int status) {
+    if (WIFEXITED(status)) {
+        return WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        return 128 + WTERMSIG(status);
+    }
+    return 128 + WSTOPSIG(status);
+}
 
-    pid_t first_cmd_pid = 0;
 
-    while (cmd != NULL) {
-        if (pipe(fd) == -1) {
-            perror("pipe");
-            exit(1);
-        }
+// Function to check whether the shell is the terminal's foreground group, so it may
+// hand the terminal to a job
+static int ownsTerminal() {
+    return isatty(STDIN_FILENO) && tcgetpgrp(STDIN_FILENO) == getpgrp();
+}
 
-        pid_t pid = fork();
-        if (pid == -1) {
-            perror("fork");
-            exit(1);
-        } else if (pid == 0) { // Child process
-            // First process PID in pipeline setting as GROUP PID
-            if (getpid() == first_cmd_pid || first_cmd_pid == 0) {
-                setpgid(0, 0);
-            }
+// Function to get the CPU time (user + system) of the foreground children reaped since
+// the last call, in microseconds
+long takeForegroundCpu() {
+    long cpu = foregroundCpu;
+    foregroundCpu = 0;
+    return cpu;
+}
 
-            signal(SIGINT, SIG_DFL);
-            signal(SIGTSTP, SIG_DFL);
-            signal(SIGTERM, SIG_DFL);
-            signal(SIGQUIT, SIG_DFL);
-            signal(SIGCONT, SIG_DFL);
-            signal(SIGHUP, SIG_DFL);
-            signal(SIGKILL, SIG_DFL);
-
-            if (prev_fd != 0) {
-                cmd->pid = pid;
-                if (dup2(prev_fd, STDIN_FILENO) == -1) {
-                    perror("dup2");
-                    exit(1);
+// Function to wait for the members of a foreground group until all have ended or one
+// stopped (CTRL + Z stops the whole group). Under 'time' each reaped member is recorded,
+// named after its stage of cmd when cmd is not NULL. Returns 1 when the group stopped
+static int waitForGroup(struct Process* processes, int count, struct Command* cmd) {
+    for (int i = 0; i < count; i++) {
+        while (processes[i].state != 2) {
+            int status;
+            struct rusage usage;
+            long waitStart = traceClock();
+            long ready = 0;
+            if (tracingEnabled()) {
+                // Wait without collecting first: "wait" is the child's run time, "reap"
+                // the shell's part from the child's exit (or stop) to collecting it
+                siginfo_t info;
+                while (waitid(P_PID, processes[i].pid, &info, WEXITED | WSTOPPED | WNOWAIT) == -1 && errno == EINTR) {
                 }
-                close(prev_fd);
+                ready = traceClock();
             }
-
-            if (cmd->next != NULL) {
-                if (dup2(fd[1], STDOUT_FILENO) == -1) {
-                    perror("dup2");
-                    exit(1);
-                }
-                close(fd[1]);
+            if (wait4(processes[i].pid, &status, WUNTRACED, &usage) == -1) {
+                processes[i].state = 2; // Already collected elsewhere
+                break;
             }
-
-            close(fd[0]);
-
-            execvp(cmd->words[0], cmd->words);
-            perror("execvp");
-            exit(1);
-        } else { // Parent process
-            close(fd[1]);
-
-            if (prev_fd != 0) {
-                close(prev_fd);
+            if (ready != 0) {
+                traceSpan("wait", waitStart, ready, processes[i].pid);
+                tracePhase("reap", ready, processes[i].pid);
             }
 
-            if (first_cmd_pid == 0) {
-                first_cmd_pid = pid;
+            if (WIFSTOPPED(status)) {
+                processes[i].state = 1;
+                processes[i].status = status;
+                return 1;
+            }
+            processes[i].state = 2;
+            processes[i].status = status;
+            foregroundCpu += usage.ru_utime.tv_sec * 1000000L + usage.ru_utime.tv_usec +
+                             usage.ru_stime.tv_sec * 1000000L + usage.ru_stime.tv_usec;
+            if (timingActive()) {
+                recordStage(cmd, processes[i].pid, &usage);
             }
+        }
+        if (cmd != NULL) {
+            cmd = cmd->next;
+        }
+    }
+    return 0;
+}
 
-            int status;
-            waitpid(pid, &status, WUNTRACED);
+// Function to run started foreground processes to completion. A stopped group becomes
+// one job. terminal: when not -1 the shell takes it back afterwards.
+// Returns the exit status of the last member
+static int runForeground(struct Process* processes, int count, pid_t pgid, int terminal,
+                         struct Command* cmd, struct Job** jobList) {
+    // Stages only match the members when every stage started
+    int stopped = waitForGroup(processes, count, (count == stageCount(cmd)) ? cmd : NULL);
 
-            if (WIFSTOPPED(status)) {
-            	printf("First job-cmd pid: %d\n", first_cmd_pid);
-                printf("\n[%d] %s Stopped\n", pid, cmd->words[0]);
-                struct Job* job = createJob(pid, first_cmd_pid, cmd->words[0], 1, cmd);
-                addJob(jobList, job);
-            }
+    if (terminal != -1) {
+        tcsetpgrp(terminal, getpgrp());
+    }
 
-            prev_fd = fd[0];
-        }
+    if (stopped) {
+        struct Job* job = createJob(pgid, processes, count, 1, cmd);
+        addJob(jobList, job);
+        printf("\n[%d]+  Stopped\t%s\n", job->number, job->command);
+        return 128 + SIGTSTP;
+    }
 
-        cmd = cmd->next;
+    int status = processes[count - 1].status;
+    if (count == 1 && cmd->next == NULL && !WIFEXITED(status)) {
+        printf("\n%s: execution error\n", cmd->words[0]);
     }
+    return exitStatus(status);
 }
 
 
-// Pipeline for commands with background processes
-void PipelineBackground(struct Command* cmd, struct Job** jobList) {
-    int fd[2];
-    int prev_fd = 0;
-    pid_t last_cmd_pid;
-    pid_t first_cmd_pid = -1;
-    char* full_expression = NULL;
-    struct Command* last_cmd = NULL;
-    
-    // Pipe for getting first command pid
-    int pipe_pid[2];
-
-    // Traverse the pipeline and set up redirections
-    while (cmd->next != NULL) {
-        if (pipe(fd) == -1) {
-            perror("pipe");
-            exit(1);
-        }
-        
-	// Pipe for getting first command pid
-        if (pipe(pipe_pid) == -1) {
-    	   perror("pipe");
-    	   exit(1);
-        }
+int executeDefault(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    if (cmd == NULL) {
+        return 0;
+    }
 
-        if (full_expression == NULL) {
-            full_expression = strdup(cmd->words[0]);
-        } else {
-            char* temp = strdup(full_expression);
-            free(full_expression);
-            full_expression = malloc(strlen(temp) + strlen(cmd->words[0]) + 4);
-            strcpy(full_expression, temp);
-            strcat(full_expression, " | ");
-            strcat(full_expression, cmd->words[0]);
-            free(temp);
-        }
+    // With the terminal the command gets its own group, so CTRL + Z and fg work on it
+    int terminal = ownsTerminal() ? STDIN_FILENO : -1;
+    pid_t pid = spawnCommand(cmd, (terminal != -1) ? 0 : -1, terminal, -1, -1, -1, jobList, historyList);
+    if (pid < 0) {
+        return (pid == SPAWN_REDIRECT_FAILED) ? 1 : 127;
+    }
+    if (terminal != -1) {
+        tcsetpgrp(terminal, pid);
+    }
 
-        pid_t pid = fork();
-        int is_first_procces = 1;
-        if (pid == -1) {
-            perror("fork");
-            exit(1);
-        } else if (pid == 0) { // Child process
-            if (prev_fd != 0) {
-                if (dup2(prev_fd, STDIN_FILENO) == -1) {
-                    perror("dup2");
-                    exit(1);
-                }
-                close(prev_fd);
-            }
-            
-            if (first_cmd_pid == -1) {
-            	first_cmd_pid = getpid();
-            	
-            	close(pipe_pid[0]);
-            	write(pipe_pid[1], &first_cmd_pid, sizeof(first_cmd_pid));
-            	close(pipe_pid[1]);
-            } 
-
-            if (dup2(fd[1], STDOUT_FILENO) == -1) {
-                perror("dup2");
-                exit(1);
-            }
-            close(fd[0]);
-            close(fd[1]);
+    struct Process process = startedProcess(pid);
+    return runForeground(&process, 1, (terminal != -1) ? pid : getpgrp(), terminal, cmd, jobList);
+}
 
-            execvp(cmd->words[0], cmd->words);
-            perror("execvp");
-            exit(1);
-        } else { // Parent process
-            close(fd[1]);
 
-            if (prev_fd != 0) {
-                close(prev_fd);
+// Function to start every stage of a pipeline at once in one new process group.
+// terminal: when not -1 the group becomes the terminal's foreground group.
+// Returns the number of started stages, written to processes; *pgid is the group.
+// *failure: 0 when the last stage started, else its exit status (1 or 127)
+static int startPipeline(struct Command* cmd, int terminal, struct Process* processes, pid_t* pgid,
+                         int* failure, struct Job** jobList, struct History** historyList) {
+    int fd[2];
+    int prev_fd = -1;
+    int started = 0;
+    *pgid = 0;
+
+    for (; cmd != NULL; cmd = cmd->next) {
+        // Pipe ends are close-on-exec, the spawned stage only keeps its own stdin/stdout
+        int out_fd = -1;
+        if (cmd->next != NULL) {
+            if (pipe2(fd, O_CLOEXEC) == -1) {
+                perror("pipe");
+                exit(1);
             }
-            
-            if (!is_first_procces) {
-            	wait(NULL);
-            } else {
-		is_first_procces = 0;
-	    }
-		
-            
-            close(pipe_pid[1]);
-            read(pipe_pid[0], &first_cmd_pid, sizeof(first_cmd_pid));
-            close(pipe_pid[0]);
-
-            prev_fd = fd[0];
-            last_cmd = cmd;  // Запоминаем последнюю команду
+            out_fd = fd[1];
         }
-        
-	
-        cmd = cmd->next;
-    }
 
-    // Build the full expression
-    if (full_expression == NULL) {
-        full_expression = strdup(cmd->words[0]);
-    } else {
-        char* temp = strdup(full_expression);
-        free(full_expression);
-        full_expression = malloc(strlen(temp) + strlen(cmd->words[0]) + 4);
-        strcpy(full_expression, temp);
-        strcat(full_expression, " | ");
-        strcat(full_expression, cmd->words[0]);
-        free(temp);
-    }
-
-    // Execute the last command in the background
-    last_cmd_pid = fork();
-    if (last_cmd_pid == -1) {
-        perror("fork");
-        exit(1);
-    } else if (last_cmd_pid == 0) { // Child process
-	signal(SIGINT, SIG_DFL);
-	signal(SIGTERM, SIG_DFL);
-	signal(SIGQUIT, SIG_DFL);
-	signal(SIGCONT, SIG_DFL);
-	signal(SIGHUP, SIG_DFL);
-	signal(SIGKILL, SIG_DFL);
-        if (prev_fd != 0) {
-            if (dup2(prev_fd, STDIN_FILENO) == -1) {
-                perror("dup2");
-                exit(1);
-            }
+        // The first stage leads the group and takes the terminal, the others join it
+        pid_t pid = spawnCommand(cmd, *pgid, (*pgid == 0) ? terminal : -1, prev_fd, out_fd, -1, jobList, historyList);
+
+        if (out_fd != -1) {
+            close(out_fd);
+        }
+        if (prev_fd != -1) {
             close(prev_fd);
         }
-
-        execvp(cmd->words[0], cmd->words);
-        perror("execvp");
-        exit(1);
-    } else { // Parent process
-        // Create node only for last command
-        printf("First job-cmd pid: %d\n", first_cmd_pid);
-        setpgid(first_cmd_pid, first_cmd_pid);
-        
-        
-        printf("Process with id [%d]\n", last_cmd_pid);
-        addJob(jobList, createJob(last_cmd_pid, first_cmd_pid, full_expression, 0, last_cmd));
-        tcsetpgrp(STDIN_FILENO, getpgrp());
+        prev_fd = (cmd->next != NULL) ? fd[0] : -1;
+
+        *failure = (pid >= 0) ? 0 : (pid == SPAWN_REDIRECT_FAILED) ? 1 : 127;
+        if (pid >= 0) {
+            if (*pgid == 0) {
+                *pgid = pid;
+                if (terminal != -1) {
+                    tcsetpgrp(terminal, pid);
+                }
+            }
+            processes[started++] = startedProcess(pid);
+        }
     }
 
-    free(full_expression);
+    return started;
 }
 
+// All stages run at once in one process group, which gets the terminal, and are reaped together
+int executePipeline(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    int terminal = ownsTerminal() ? STDIN_FILENO : -1;
+    int count = stageCount(cmd);
 
-void executeCommand(struct Command* cmd, struct Job** jobList, struct History** historyList, int firstOperatorFlag, int secondFlag) {
-    if (cmd == NULL) {
-        return;
+    struct Process* processes = (struct Process*)malloc(count * sizeof(struct Process));
+    if (processes == NULL) {
+        perror("Memory allocation");
+        exit(1);
     }
 
-    // Check if word is '#' then won't execute following commands
-    if (strcmp(cmd->words[0], "#") == 0) {
-        cmd->next = NULL;
-        return;
+    pid_t pgid;
+    int failure;
+    int started = startPipeline(cmd, terminal, processes, &pgid, &failure, jobList, historyList);
+    int result = failure;
+
+    // The status is the last stage's; one that did not start has its failure status
+    if (started > 0) {
+        int status = runForeground(processes, started, pgid, terminal, cmd, jobList);
+        if (failure == 0) {
+            result = status;
+        }
     }
 
-    // Check the command's flag and execute accordingly
-    if ((firstOperatorFlag == 3 && secondFlag == 4) || (firstOperatorFlag == 4 && secondFlag == 3)) {
-        executeCommandSequence(cmd);
-    } else if (firstOperatorFlag == 1 && secondFlag == 2) { // Pipeline + Background ('&')
-    	PipelineBackground(cmd, jobList);
-    
-    } else if (firstOperatorFlag == 1 || (cmd->flag == 1)) { // Pipe ('|')
-        executePipeline(cmd, jobList);
+    free(processes);
+    return result;
+}
 
-    } else if (firstOperatorFlag == 2 || (cmd->flag == 2)) { // Background ('&')
-    	executeInBackground(cmd, jobList);
 
-    } else if (firstOperatorFlag == 3 || (cmd->flag == 3)) { // Logical OR ('')
-        executeOrOperator(cmd);
+// Pipeline for commands with background processes
+void PipelineBackground(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    int count = stageCount(cmd);
 
-    } else if (firstOperatorFlag == 4 || (cmd->flag == 4)) { // Logical AND ('&&')
-        executeAndOperator(cmd);
+    struct Process* processes = (struct Process*)malloc(count * sizeof(struct Process));
+    if (processes == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
 
-    } else if (firstOperatorFlag == 5 || (cmd->flag == 5)) { // Sequential execution (';')
-        executeSeqOperator(cmd);
+    pid_t pgid;
+    int failure;
+    int started = startPipeline(cmd, -1, processes, &pgid, &failure, jobList, historyList);
 
-    } else if (firstOperatorFlag == 6 || (cmd->flag == 6)) { // Redirect output to file '>'
-        struct Command* next_cmd = cmd->next;
-        if (next_cmd != NULL) {
-            next_cmd->filename = next_cmd->words[0];
-            outputInFile(cmd, next_cmd->filename);
-        }
+    if (started > 0) {
+        printf("First job-cmd pid: %d\n", pgid);
+        printf("Process with id [%d]\n", processes[started - 1].pid);
+        addJob(jobList, createJob(pgid, processes, started, 0, cmd));
+        tcsetpgrp(STDIN_FILENO, getpgrp());
+    }
 
-    } else if (firstOperatorFlag == 7 || (cmd->flag == 7)) { // Append data to the end of the file '>>'
-        struct Command* next_cmd = cmd->next;
-        if (next_cmd != NULL) {
-            next_cmd->filename = next_cmd->words[0];
-            appendToFile(cmd, next_cmd->filename);
-        }
+    free(processes);
+}
 
-    } else if (firstOperatorFlag == 8 || (cmd->flag == 8)) { // Output file contents to the stream '<'
-        struct Command* next_cmd = cmd->next;
-        if (next_cmd != NULL) {
-            next_cmd->filename = next_cmd->words[0];
-            inputFromFile(cmd, next_cmd->filename);
-        }
 
-    } else { // Default, no operator
-        executeDefault(cmd, jobList, historyList);
+// Function to find the first simple command of a subtree (for job names)
+static struct Command* firstCommand(struct Ast* ast, int index) {
+    while (ast->nodes[index].cmd == NULL) {
+        index = ast->nodes[index].left;
     }
+    return ast->nodes[index].cmd;
 }
 
+// Function to run any node in the background: commands and pipelines directly,
+// and-or lists in a forked subshell
+static void executeNodeInBackground(struct Ast* ast, int index, struct Job** jobList, struct History** historyList) {
+    struct Node* node = &ast->nodes[index];
 
-void clearJobs(struct Job** jobList) {
-	struct Job* current = *jobList;
-	struct Job* next;
-	
-	while (current != NULL) {
-		next = current->next;
-		free(current->command);
-		free(current);
-		current = next;
-	}
-	
-	*jobList = NULL;
-}
-
-// get the number of tasks in the JobList
-int getJobCount(struct Job* jobList) {
-    int count = 0;
-    struct Job* current = jobList;
+    if (node->type == NODE_COMMAND) {
+        executeInBackground(node->cmd, jobList, historyList);
+        return;
+    } else if (node->type == NODE_PIPELINE) {
+        PipelineBackground(node->cmd, jobList, historyList);
+        return;
+    }
 
-    while (current != NULL) {
-        count++;
-        current = current->next;
+    pid_t pid = forkChild(0);
+    if (pid == -1) {
+        return;
+    } else if (pid == 0) { // Subshell
+        exit(executeNode(ast, index, jobList, historyList));
     }
 
-    return count;
+    printf("Process with id [%d]\n", pid);
+
+    struct Command* cmd = firstCommand(ast, index);
+    struct Process process = startedProcess(pid);
+    addJob(jobList, createJob(pid, &process, 1, 0, cmd));
 }
 
+// Tree-walking executor, returns the exit status of the node
+int executeNode(struct Ast* ast, int index, struct Job** jobList, struct History** historyList) {
+    struct Node* node = &ast->nodes[index];
+    int status;
 
-// Function to get the last job in the job list
-struct Job* getLastJob(struct Job* jobList) {
-    if (jobList == NULL) {
-        return NULL;
+    switch (node->type) {
+        case NODE_COMMAND: {
+            // Builtins run in-process, without fork+exec
+            struct Builtin* builtin = findBuiltin(node->cmd->words[0]);
+            if (builtin != NULL) {
+                return runBuiltin(builtin, node->cmd, jobList, historyList);
+            }
+            return executeDefault(node->cmd, jobList, historyList);
+        }
+        case NODE_PIPELINE:
+            return executePipeline(node->cmd, jobList, historyList);
+        case NODE_AND:
+            status = executeNode(ast, node->left, jobList, historyList);
+            if (status == 0 && exitRequested() == -1) {
+                status = executeNode(ast, node->right, jobList, historyList);
+            }
+            return status;
+        case NODE_OR:
+            status = executeNode(ast, node->left, jobList, historyList);
+            if (status != 0 && exitRequested() == -1) {
+                status = executeNode(ast, node->right, jobList, historyList);
+            }
+            return status;
+        case NODE_SEQ:
+            status = executeNode(ast, node->left, jobList, historyList);
+            if (exitRequested() != -1) {
+                return status;
+            }
+            return executeNode(ast, node->right, jobList, historyList);
+        case NODE_BACKGROUND:
+            executeNodeInBackground(ast, node->left, jobList, historyList);
+            return 0;
+        case NODE_TIME:
+            return executeTimed(ast, node->left, jobList, historyList);
+        default:
+            return 1;
     }
+}
 
-    struct Job* current = jobList;
-    while (current->next != NULL) {
-        current = current->next;
+// Function to execute a parsed command line
+int executeCommand(struct Ast* ast, struct Job** jobList, struct History** historyList) {
+    if (ast == NULL) {
+        return 0;
     }
 
-    return current;
+    return executeNode(ast, ast->root, jobList, historyList);
 }
 
 
@@ -484,7 +402,7 @@ void printJobsList(struct Job* jobList) {
                 status = "Unknown";
         }
         if (current != NULL || current->command != NULL) {
-        	printf("Group ID: [%d] ---- Process ID: [%d] %s\t%s\n", current->pgid, current->pid, status, current->command);
+        	printf("[%d] Group ID: [%d] ---- Process ID: [%d] %s\t%s\n", current->number, current->pgid, current->pid, status, current->command);
         }
         current = current->next;
     }
@@ -499,240 +417,259 @@ void printJobs(struct Job* jobList) {
     }
 }
 
-// Function to find a job by PID or command name
-struct Job* findJobByPid(struct Job* jobList, char* identifier) {
-    struct Job* current = jobList;
+// Function to start receiving SIGCHLD through a descriptor instead of a handler.
+// The signal stays blocked in the shell; spawned children get an empty mask
+void initChildSignals() {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
 
-    while (current != NULL) {
-        // Check if the identifier matches either the PID or command name
-        if (current->pid == atoi(identifier) || strcmp(current->command, identifier) == 0) {
-            return current;
-        }
+    if (sigprocmask(SIG_BLOCK, &set, NULL) == -1) {
+        perror("sigprocmask");
+        return;
+    }
 
-        current = current->next;
+    childSignalFd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (childSignalFd == -1) {
+        perror("signalfd");
     }
+}
 
-    return NULL;  // Job not found
+// Function to get the descriptor that becomes readable when a child changes state
+int childEventFd() {
+    return childSignalFd;
 }
 
+// Function to describe how a job was ended by a signal
+static const char* signalDescription(int sig) {
+    switch (sig) {
+        case SIGTERM:
+            return "Terminated";
+        case SIGKILL:
+            return "Killed";
+        case SIGINT:
+            return "Interrupted";
+        case SIGHUP:
+            return "Hangup";
+        case SIGQUIT:
+            return "Quited";
+        default:
+            return strsignal(sig);
+    }
+}
 
-// Function to find a job by group PID
-struct Job* findJobByPGID(struct Job* jobList, pid_t pgid) {
-    struct Job* currentJob = jobList;
-    while (currentJob != NULL) {
-        if (currentJob->pgid == pgid) {
-            return currentJob;
-        }
-        currentJob = currentJob->next;
+// Function to report a job whose process ended and remove it from the list.
+// newLine: a prompt is on screen, start the notice on a new line
+void finishJob(struct Job** jobList, struct Job* job, int status, int newLine) {
+    if (newLine) {
+        printf("\n");
+    }
+    if (WIFEXITED(status)) {
+        printf("[%d]+  Done\t%s\n", job->number, job->command);
+    } else {
+        printf("[%d]+  %s\t%s\n", job->number, signalDescription(WTERMSIG(status)), job->command);
     }
-    return NULL; // If Node was not found
+
+    jobsFinished++;
+    lastJobStatus = exitStatus(status);
+    removeFromJobList(jobList, job->pid);
 }
 
-// Function for removing a Job from the list
-void removeFromJobList(struct Job** jobList, pid_t pid) {
-    struct Job* current = *jobList;
-    struct Job* prev = NULL;
+// Function to stop watching a job whose main process was reaped while other members
+// still run: its pidfd stays readable and would wake the event loop forever
+static void releaseMainProcess(struct Job* job) {
+    if (job->pidfd != -1 && job->processes[job->processCount - 1].state == 2) {
+        unwatchProcess(job->pidfd);
+        job->pidfd = -1;
+    }
+}
 
-    while (current != NULL) {
-        if (current->pid == pid) {
-            if (prev == NULL) {
-                *jobList = current->next;
-            } else {
-                prev->next = current->next;
-            }
-	
-            free(current->command);
-            free(current);
-	    //current->commands = NULL;	
-	
-            return;
+// Function to record a state change of one job member; the job ends with its last
+// running member. Returns 1 when a notice was printed
+int updateProcess(struct Job** jobList, pid_t pid, int status, int newLine) {
+    struct Process* process = findProcess(*jobList, pid);
+    if (process == NULL) {
+        return 0; // Not a job member
+    }
+    struct Job* job = process->job;
+
+    if (WIFSTOPPED(status)) {
+        process->state = 1;
+        job->state = 1;
+        return 0;
+    } else if (WIFCONTINUED(status)) {
+        process->state = 0;
+        job->state = 0;
+        return 0;
+    }
+
+    process->state = 2;
+    process->status = status;
+
+    for (int i = 0; i < job->processCount; i++) {
+        if (job->processes[i].state != 2) {
+            releaseMainProcess(job);
+            return 0;
         }
+    }
 
-        prev = current;
-        current = current->next;
+    finishJob(jobList, job, job->processes[job->processCount - 1].status, newLine);
+    return 1;
+}
+
+// Function to send a signal to a whole job with one killpg. A job left in the shell's
+// own group (started without a terminal) gets it member by member
+int signalJob(struct Job* job, int sig) {
+    if (job->pgid != getpgrp()) {
+        return killpg(job->pgid, sig);
     }
+
+    for (int i = 0; i < job->processCount; i++) {
+        if (job->processes[i].state != 2) {
+            kill(job->processes[i].pid, sig);
+        }
+    }
+    return 0;
 }
 
+// Function to get how many jobs have ended so far
+long finishedJobCount() {
+    return jobsFinished;
+}
 
-void updateJobList(struct Job** jobList) {
-    struct Job* current = *jobList;
-    struct Job* prev = NULL;
+// Function to get the exit status of the job that ended last
+int lastFinishedStatus() {
+    return lastJobStatus;
+}
 
-    while (current != NULL) {
-        int all_jobs_done = 1; // Checking flag for all jobes' status in the Node
-        struct Job* temp = current; // Temporary pointer for every job in the Node
+// Function to collect every child that changed state since the last call. Nothing is
+// done unless SIGCHLD arrived, and only the jobs that changed are touched.
+// atPrompt: a prompt is on screen, so notices start on a new line.
+// Returns the number of notices printed
+int reapChildren(struct Job** jobList, int atPrompt) {
+    struct signalfd_siginfo info;
+    int pending = 0;
 
-        while (temp != NULL) {
-            int status;
-            pid_t result = waitpid(temp->pid, &status, WNOHANG | WUNTRACED);
-            
-            /* If there is unexpected error happened, for example: job's order execution error. 
-               Then clear the Job List and recreate the right order. 
-               
-               !!! All jobs should be executed in correct order !!! */
-            if (result == -1) {
-                perror("waitpid");
-                
-                struct Job* temp = *jobList;
-                while (temp != NULL) {
-                	kill(temp->pid, SIGKILL);
-                	temp = temp->next;
-                }
-                clearJobs(jobList);
-                return;
-            } else if (result == 0 || (WIFSTOPPED(status) && temp->state)) {
-                // If some job in JobNode is still running or it was stopped, then change the flag's value and break from check cycle 
-                all_jobs_done = 0;
-                break;
-            } else if (WIFEXITED(status)) printf("[%d]+  Done\t%s\n", temp->pid, temp->command);
-            else if (WIFSIGNALED(status) && (temp->state == 2 || temp->state == 3 || temp->state == 4 || temp->state == 5 || temp->state == 6)) {
-                // If job got the signal, the print description about it
-                if (temp->state == 2) printf("[%d]+  Terminated\t%s\n", temp->pid, temp->command);
-                else if (temp->state == 3) printf("[%d]+  Killed\t%s\n", temp->pid, temp->command);
-                else if (temp->state == 4) printf("[%d]+  Interrupted\t%s\n", temp->pid, temp->command);
-                else if (temp->state == 5) printf("[%d]+  Hangup\t%s\n", temp->pid, temp->command);
-                else if (temp->state == 6) printf("[%d]+  Quited\t%s\n", temp->pid, temp->command);
-                
-                break;
-            }
+    while (read(childSignalFd, &info, sizeof(info)) == sizeof(info)) {
+        pending = 1;
+    }
+    if (!pending && childSignalFd != -1) {
+        return 0;
+    }
 
-            temp = temp->next;
-        }
+    int notices = 0;
+    int status;
+    pid_t pid;
 
-        if (all_jobs_done) {
-        // All jobs in the Node are done or got signal, then delete the jobNode
-           if (prev == NULL) { 
-		   // Current job is the first in the list
-		   struct Job* nextNode = current->next;
-		   *jobList = current->next;
-		   free(current->command);
-	   	   free(current);
-	   	   *jobList = nextNode;
-		   current = nextNode;
-	   } else {
-	   	prev->next = current->next;
-	   	free(current->command);
-	   	free(current);
-	   	current = prev->next;
-	   }	
-        } else {
-            // Not All jobs in the Node are done or got signal, then get to the next node
-            prev = current;
-            current = current->next;
-        }
+    while ((pid = waitpid(-1, &status, WNOHANG | WUNTRACED | WCONTINUED)) > 0) {
+        notices += updateProcess(jobList, pid, status, atPrompt && notices == 0);
     }
+
+    return notices;
 }
 
 
-// Function to bring a background job to the foreground by PID or command name
+// Function to bring a job to the foreground by %N, PID or command name (default: the last job)
 void bringToForeground(struct Job** jobList, char* identifier) {
-
-    if (identifier == NULL) {
-        // If identifier is NULL, bring the last job to the foreground
-        struct Job* lastJob = getLastJob(*jobList);
-        if (lastJob != NULL) {
-	    tcsetpgrp(STDIN_FILENO, lastJob->pid);
-            kill(lastJob->pid, SIGCONT);
-            int status;
-            waitpid(lastJob->pid, &status, WUNTRACED);
-
-            if (WIFEXITED(status)) {
-            	printf("\n[%d]+    Done\t\t%s\n", lastJob->pid, lastJob->command);
-            	removeFromJobList(jobList, lastJob->pid);
-            } else if(WIFSIGNALED(status)) {
-            	printf("\n[%d]+    Terminated\t\t%s\n", lastJob->pid, lastJob->command);
-            	removeFromJobList(jobList, lastJob->pid);
-            
-            } else if (WIFSTOPPED(status)) {
-		    // CTRL + Z pushed
-		    printf("\nStopped\n");
-		    lastJob->state = 1;
-            } else {
-            	printf("\n%s: execution error\n", lastJob->commands->words[0]);
-            }
-        } else {
+    struct Job* job = (identifier != NULL) ? findJobByPid(*jobList, identifier) : getLastJob(*jobList);
+    if (job == NULL) {
+        if (identifier == NULL) {
             printf("No background jobs to bring to foreground\n");
+        } else {
+            printf("Job with PID or command name '%s' not found\n", identifier);
         }
-        tcsetpgrp(STDIN_FILENO, getpgrp());
         return;
     }
 
-    struct Job* current = *jobList;
+    printf("%s\n", job->command);
+    int terminal = ownsTerminal();
+    if (terminal) {
+        tcsetpgrp(STDIN_FILENO, job->pgid);
+    }
 
-    // Find the job by PID or command name
-    while (current != NULL) {
-        if (current->pid == atoi(identifier) || strcmp(current->command, identifier) == 0) {
-            tcsetpgrp(STDIN_FILENO, current->pid);
-	    kill(current->pid, SIGCONT);
-            int status;
-            waitpid(current->pid, &status, WUNTRACED);
-            
-            if (WIFEXITED(status)) {
-            	printf("\n[%d]+    Done\t\t%s\n", current->pid, current->command);
-            	removeFromJobList(jobList, current->pid);
-            } else if(WIFSIGNALED(status)) {
-            	printf("\n[%d]+    Terminated\t\t%s\n", current->pid, current->command);
-            	removeFromJobList(jobList, current->pid);
-            
-            } else if (WIFSTOPPED(status)) {
-		    // CTRL + Z pushed
-		    printf("\nStopped\n");
-		   current->state = 1;
-            } else {
-            	printf("\n%s: execution error\n", current->commands->words[0]);
-            }
-	    tcsetpgrp(STDIN_FILENO, getpgrp());
-            return;
+    // The whole group continues, members keep their slots in the job
+    for (int i = 0; i < job->processCount; i++) {
+        if (job->processes[i].state == 1) {
+            job->processes[i].state = 0;
         }
+    }
+    job->state = 0;
+    signalJob(job, SIGCONT);
 
-        current = current->next;
+    int stopped = waitForGroup(job->processes, job->processCount, NULL);
+
+    if (terminal) {
+        tcsetpgrp(STDIN_FILENO, getpgrp());
     }
 
-    printf("Job with PID or command name '%s' not found\n", identifier);
+    if (stopped) {
+        // CTRL + Z pushed
+        job->state = 1;
+        releaseMainProcess(job);
+        printf("\n[%d]+  Stopped\t%s\n", job->number, job->command);
+    } else {
+        finishJob(jobList, job, job->processes[job->processCount - 1].status, 0);
+    }
 }
 
-// Function to move a job to the background by PID or command name
+// Function to move a job to the background by %N, PID or command name (default: the last job)
 void resumeInBackground(struct Job** jobList, char* identifier) {
-    if (identifier == NULL) {
-        struct Job* lastJob = getLastJob(*jobList);
-        if (lastJob != NULL) {
-            pid_t pid = lastJob->pid;
-            //tcsetpgrp(STDIN_FILENO, getpgrp());
-            kill(pid, SIGCONT);
-            lastJob->state = 0;
-            printf("[%d]+  Running\t%s\n", getJobCount(*jobList), lastJob->command);
-        } else {
+    struct Job* job = (identifier != NULL) ? findJobByPid(*jobList, identifier) : getLastJob(*jobList);
+    if (job == NULL) {
+        if (identifier == NULL) {
             printf("No background jobs found.\n");
+        } else {
+            printf("Job with identifier %s not found or not stopped.\n", identifier);
         }
         return;
     }
 
-    pid_t pid = atoi(identifier);
-
-    struct Job* current = findJobByPid(*jobList, identifier);
-
-    if (current != NULL) {
-       if (current->pid == pid) {
-            if (current->state == 1) {
-                // Job is currently stopped, resume it in the background
-                kill(pid, SIGCONT);
-                current->state = 0;  // Update job state to running
-                printf("[%d]+  Running\t%s\n", getJobCount(*jobList), current->command);
-            } else {
-                printf("[%d]+  Already running\t%s\n", getJobCount(*jobList), current->command);
-            }
-            return;
-       }
+    if (job->state != 1) {
+        printf("[%d]+  Already running\t%s\n", job->number, job->command);
+        return;
     }
 
-    printf("Job with identifier %s not found or not stopped.\n", identifier);
+    // Job is currently stopped, resume the whole group in the background
+    for (int i = 0; i < job->processCount; i++) {
+        if (job->processes[i].state == 1) {
+            job->processes[i].state = 0;
+        }
+    }
+    job->state = 0;
+    signalJob(job, SIGCONT);
+    printf("[%d]+  Running\t%s\n", job->number, job->command);
 }
 
 
-// Function to kill a process by identifier (PID or command name)
+// Function to get the job state shown after a signal was sent
+static int stateAfterSignal(int sig, int state) {
+    switch (sig) {
+        case SIGHUP:
+            return 5;
+        case SIGINT:
+            return 4;
+        case SIGQUIT:
+            return 6;
+        case SIGKILL:
+            return 3;
+        case SIGTERM:
+            return 2;
+        case SIGCONT:
+            return 0;
+        case SIGSTOP:
+        case SIGTSTP:
+            return 1;
+        default:
+            return state;
+    }
+}
+
+// Function to kill a job by identifier: 'kill sig %N|name' and the group forms
+// 'kill -g pgid' (SIGTERM) and 'kill sig -pgid' signal the whole process group at once,
+// 'kill sig pid' only that process
 void killProcessByIdentifier(struct Command* commands, struct Job** jobList, char** identifierArray) {
     char* identifier = identifierArray[0];
-    char* group_pid = identifierArray[1];
+    char* target = identifierArray[1];
 
     if (strcmp(identifier, "-l") == 0) {
         // List of the signals
@@ -742,114 +679,51 @@ void killProcessByIdentifier(struct Command* commands, struct Job** jobList, cha
         printf("11) SIGSEGV\t12) SIGUSR2\t13) SIGPIPE\t14) SIGALRM\t15) SIGTERM\n");
         printf("16) SIGSTKFLT\t17) SIGCHLD\t18) SIGCONT\t19) SIGSTOP\t20) SIGTSTP\n");
         return;
-    } else if (strcmp(identifier, "-g") == 0) {
-	printf("'-g': kill signal to the job group\n");
-	int pgid = atoi(identifierArray[1]);
-	struct Job* jobNode = findJobByPGID(*jobList, pgid);
-	
-	if (jobNode == NULL) {
-		printf("bash: kill: no such job\n");
-    		return;
-    	} else {
-    		struct Job* currentJob = jobNode;
-		while (currentJob != NULL) {
-		    if (currentJob->pid != 0) {
-		   	if (currentJob->state != 1) {
-		        	kill(currentJob->pid, SIGTERM);
-		        	currentJob->state = 2;
-		        } else {
-		       		kill(currentJob->pid, SIGCONT);
-		       		kill(currentJob->pid, SIGTERM);
-		       		currentJob->state = 2;
-		       	}
-		        printf("Sent SIGTERM signal to process with PID %d\n", currentJob->pid);
-		    }
-		    currentJob = currentJob->next;
-		}
-	}
-    		
-	return;
-    } else if (*group_pid == '-') {
-    	printf("'-pid': kill signal to the job group\n");
-	int pgid = atoi(identifierArray[1]);
-	int sig_num = atoi(identifier);
-	int state;
-	pgid = abs(pgid);
-	struct Job* jobNode = findJobByPGID(*jobList, pgid);
-	
-	
-	if (sig_num == 1) state = 5;
-        else if (sig_num == 2) state = 4;
-        else if (sig_num == 3) state = 6;
-        else if (sig_num == 9) state = 3;
-        else if (sig_num == 15) state = 2;
-        else if (sig_num == 18) state = 0;
-        else if (sig_num == 19 || sig_num == 20) state = 1;
-	
-	if (jobNode == NULL) {
-		printf("bash: kill: no such job\n");
-    		return;
-    	} else {
-    		struct Job* currentJob = jobNode;
-		while (currentJob != NULL) {
-		    if (currentJob->pid != 0) {
-		   	if (currentJob->state != 1) {
-		        	kill(currentJob->pid, sig_num);
-		        	currentJob->state = state;
-		        } else {
-		       		kill(currentJob->pid, SIGCONT);
-		       		kill(currentJob->pid, sig_num);
-		       		currentJob->state = state;
-		       	}
-
-		        printf("Sent %s signal to process with PID %d\n", strsignal(sig_num), currentJob->pid);
-		    }
-		    currentJob = currentJob->next;
-		}
-	}
-    	return;
-    }
-    	
-    
-    int sig_num = atoi(identifierArray[0]);
-    int pid = atoi(identifierArray[1]);
-    int state;
-    
-    if (sig_num == 1) state = 5;
-    else if (sig_num == 2) state = 4;
-    else if (sig_num == 3) state = 6;
-    else if (sig_num == 9) state = 3;
-    else if (sig_num == 15) state = 2;
-    else if (sig_num == 18) state = 0;
-    else if (sig_num == 19 || sig_num == 20) state = 1;
-    
-        
-    struct Job* job = findJobByPid(*jobList, identifierArray[1]);
-    
+    }
+
+    int sig;
+    int group = 1;
+    struct Job* job;
+
+    if (strcmp(identifier, "-g") == 0) {
+        sig = SIGTERM;
+        job = findJobByPGID(*jobList, atoi(target));
+    } else if (target[0] == '-') {
+        sig = atoi(identifier);
+        job = findJobByPGID(*jobList, atoi(target + 1));
+    } else {
+        sig = atoi(identifier);
+        job = findJobByPid(*jobList, target);
+        group = !isdigit((unsigned char)target[0]);
+    }
+
     if (job == NULL) {
-    	printf("bash: kill: no such job\n");
-    	return;
+        printf("bash: kill: no such job\n");
+        return;
+    }
+
+    int result;
+    if (group) {
+        result = signalJob(job, sig);
+    } else if (atoi(target) == job->pid) {
+        result = signalProcess(job, sig); // Through the pidfd, safe against pid reuse
     } else {
-    	if (kill(job->pid, sig_num) == -1) {
-    		perror("kill");
-    	}
-    	job->state = state;
+        result = kill(atoi(target), sig);
     }
-}
 
-    
-// Function to wait for a specific process to finish
-void waitProcess(struct Job** jobList, pid_t pid) {    
-    int status;
-    
-    waitpid(pid, &status, WUNTRACED);
-    
-    if (WIFEXITED(status)) {
-        printf("[%d]+	Done\t%s\n", pid, (*jobList)->command);
-    } else if (WIFSIGNALED(status)) {
-        printf("[%d]+	Terminated\t%s\n", pid, (*jobList)->command);
+    if (result == -1) {
+        perror("kill");
+        return;
+    }
+
+    // A stopped job must run to act on the signal
+    if (job->state == 1 && sig != SIGKILL && sig != SIGCONT && sig != SIGSTOP && sig != SIGTSTP) {
+        signalJob(job, SIGCONT);
     }
-    
-    removeFromJobList(jobList, pid);
-}
 
+    if (strcmp(identifier, "-g") == 0 || target[0] == '-') {
+        printf("Sent %s signal to process group %d\n", strsignal(sig), job->pgid);
+    }
+
+    job->state = stateAfterSignal(sig, job->state);
+}
@@ -0,0 +1,340 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#include "bash_func.h"
+
+#define JOB_TABLE_MIN_BUCKETS 64 // Buckets per index at first (power of two), doubled as jobs are added
+
+
+// The list behind jobList keeps display order; these hash indexes give constant-time
+// lookup by pgid and job number, and by the pid of any member process.
+// There is one job table per shell
+static struct Job** buckets[JOB_INDEX_COUNT];
+static struct Process** processBuckets = NULL;
+static unsigned int bucketCount = 0;
+static int jobCount = 0;
+static int processCount = 0;
+static struct Job* tailJob = NULL; // Newest job, it also has the highest number
+
+
+// Function to get the key of a job in one index
+static int jobKey(const struct Job* job, int index) {
+    return (index == JOB_BY_PGID) ? job->pgid : job->number;
+}
+
+// Multiplicative hash: pids and job numbers are mostly consecutive
+static unsigned int bucketOf(int key) {
+    return ((unsigned int)key * 2654435761u) & (bucketCount - 1);
+}
+
+// Function to put a job and its processes into every index
+static void indexJob(struct Job* job) {
+    for (int i = 0; i < JOB_INDEX_COUNT; i++) {
+        unsigned int slot = bucketOf(jobKey(job, i));
+        job->chain[i] = buckets[i][slot];
+        buckets[i][slot] = job;
+    }
+
+    for (int i = 0; i < job->processCount; i++) {
+        struct Process* process = &job->processes[i];
+        unsigned int slot = bucketOf(process->pid);
+        process->chain = processBuckets[slot];
+        processBuckets[slot] = process;
+    }
+}
+
+// Function to take a job and its processes out of every index
+static void unindexJob(struct Job* job) {
+    for (int i = 0; i < JOB_INDEX_COUNT; i++) {
+        struct Job** link = &buckets[i][bucketOf(jobKey(job, i))];
+        while (*link != job) {
+            link = &(*link)->chain[i];
+        }
+        *link = job->chain[i];
+    }
+
+    for (int i = 0; i < job->processCount; i++) {
+        struct Process** link = &processBuckets[bucketOf(job->processes[i].pid)];
+        while (*link != &job->processes[i]) {
+            link = &(*link)->chain;
+        }
+        *link = job->processes[i].chain;
+    }
+}
+
+// Function to allocate an empty bucket array
+static void* allocateBuckets(size_t size) {
+    void* array = calloc(bucketCount, size);
+    if (array == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+    return array;
+}
+
+// Function to grow the indexes to at least needed buckets and put every job back
+static void growIndexes(struct Job* jobList, unsigned int needed) {
+    bucketCount = (bucketCount == 0) ? JOB_TABLE_MIN_BUCKETS : bucketCount * 2;
+    while (bucketCount < needed) {
+        bucketCount *= 2;
+    }
+
+    for (int i = 0; i < JOB_INDEX_COUNT; i++) {
+        free(buckets[i]);
+        buckets[i] = (struct Job**)allocateBuckets(sizeof(struct Job*));
+    }
+    free(processBuckets);
+    processBuckets = (struct Process**)allocateBuckets(sizeof(struct Process*));
+
+    for (struct Job* job = jobList; job != NULL; job = job->next) {
+        indexJob(job);
+    }
+}
+
+// Function to find a job in one index
+static struct Job* findIndexed(int index, int key) {
+    if (bucketCount == 0) {
+        return NULL;
+    }
+
+    for (struct Job* job = buckets[index][bucketOf(key)]; job != NULL; job = job->chain[index]) {
+        if (jobKey(job, index) == key) {
+            return job;
+        }
+    }
+    return NULL;
+}
+
+
+// Function to free one Job with its own copy of the commands
+static void freeJob(struct Job* job) {
+    if (job->pidfd != -1) {
+        unwatchProcess(job->pidfd);
+    }
+    free(job->command);
+    free(job->commands);
+    free(job);
+}
+
+// Function to build a job's display text once, e.g. "sleep 5 | grep x"
+static char* jobText(const struct Command* cmd) {
+    size_t length = 1;
+    for (const struct Command* stage = cmd; stage != NULL; stage = stage->next) {
+        for (int i = 0; stage->words[i] != NULL; i++) {
+            length += strlen(stage->words[i]) + 1;
+        }
+        length += 2; // "| "
+    }
+
+    char* text = (char*)malloc(length);
+    if (text == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+
+    char* end = text;
+    for (const struct Command* stage = cmd; stage != NULL; stage = stage->next) {
+        if (stage != cmd) {
+            memcpy(end, " | ", 3);
+            end += 3;
+        }
+        for (int i = 0; stage->words[i] != NULL; i++) {
+            if (i > 0) {
+                *end++ = ' ';
+            }
+            size_t wordLength = strlen(stage->words[i]);
+            memcpy(end, stage->words[i], wordLength);
+            end += wordLength;
+        }
+    }
+    *end = '\0';
+
+    return text;
+}
+
+// Function for creating a new Job: one process group with its member processes in
+// pipeline order (pid, state and status are copied). The last member is the job's main process
+struct Job* createJob(pid_t pgid, const struct Process* processes, int count, int state, struct Command* commands) {
+    struct Job* job = (struct Job*)malloc(sizeof(struct Job) + count * sizeof(struct Process));
+    if (job == NULL) {
+        perror("Memory allocation");
+        return NULL;
+    }
+
+    job->pid = processes[count - 1].pid;
+    job->pgid = pgid;
+    job->number = 0; // Given by addJob
+    job->state = state;
+    job->commands = copyCommandList(commands); // the line's arena is reset after execution
+    job->command = jobText(job->commands);
+    job->pidfd = watchProcess(job->pid);
+    job->next = NULL;
+    job->prev = NULL;
+
+    job->processCount = count;
+    for (int i = 0; i < count; i++) {
+        job->processes[i].pid = processes[i].pid;
+        job->processes[i].state = processes[i].state;
+        job->processes[i].status = processes[i].status;
+        job->processes[i].job = job;
+    }
+
+    return job;
+}
+
+// Function for adding a Job at the end of the list, it gets the next job number
+void addJob(struct Job** jobList, struct Job* newJob) {
+    if (newJob == NULL) {
+        return;
+    }
+
+    // Both indexes share the bucket count, it covers the larger of them
+    unsigned int needed = processCount + newJob->processCount;
+    if (needed > bucketCount) {
+        growIndexes(*jobList, needed);
+    }
+
+    newJob->number = (tailJob != NULL) ? tailJob->number + 1 : 1;
+    newJob->prev = tailJob;
+    newJob->next = NULL;
+
+    if (tailJob != NULL) {
+        tailJob->next = newJob;
+    } else {
+        *jobList = newJob;
+    }
+    tailJob = newJob;
+    jobCount++;
+    processCount += newJob->processCount;
+
+    indexJob(newJob);
+}
+
+// Function for removing a Job from the list, by the pid of any of its processes
+void removeFromJobList(struct Job** jobList, pid_t pid) {
+    struct Job* job = findJobByProcess(*jobList, pid);
+    if (job == NULL) {
+        return;
+    }
+
+    if (job->prev != NULL) {
+        job->prev->next = job->next;
+    } else {
+        *jobList = job->next;
+    }
+
+    if (job->next != NULL) {
+        job->next->prev = job->prev;
+    } else {
+        tailJob = job->prev;
+    }
+
+    unindexJob(job);
+    jobCount--;
+    processCount -= job->processCount;
+    freeJob(job);
+}
+
+void clearJobs(struct Job** jobList) {
+    struct Job* current = *jobList;
+    struct Job* next;
+
+    while (current != NULL) {
+        next = current->next;
+        freeJob(current);
+        current = next;
+    }
+
+    for (int i = 0; i < JOB_INDEX_COUNT; i++) {
+        free(buckets[i]);
+        buckets[i] = NULL;
+    }
+    free(processBuckets);
+    processBuckets = NULL;
+    bucketCount = 0;
+    jobCount = 0;
+    processCount = 0;
+    tailJob = NULL;
+
+    *jobList = NULL;
+}
+
+// Function to close every job's pidfd in a forked child, which must not keep the
+// shell's watched descriptors alive
+void closeJobDescriptors() {
+    for (struct Job* job = tailJob; job != NULL; job = job->prev) {
+        if (job->pidfd != -1) {
+            close(job->pidfd);
+        }
+    }
+}
+
+// get the number of tasks in the JobList
+int getJobCount(struct Job* jobList) {
+    return jobCount;
+}
+
+// Function to get the last job in the job list
+struct Job* getLastJob(struct Job* jobList) {
+    return tailJob;
+}
+
+// Function to find a job member by its process ID
+struct Process* findProcess(struct Job* jobList, pid_t pid) {
+    if (bucketCount == 0) {
+        return NULL;
+    }
+
+    for (struct Process* process = processBuckets[bucketOf(pid)]; process != NULL; process = process->chain) {
+        if (process->pid == pid) {
+            return process;
+        }
+    }
+    return NULL;
+}
+
+// Function to find the job a process belongs to
+struct Job* findJobByProcess(struct Job* jobList, pid_t pid) {
+    struct Process* process = findProcess(jobList, pid);
+    return (process != NULL) ? process->job : NULL;
+}
+
+// Function to find a job by group PID
+struct Job* findJobByPGID(struct Job* jobList, pid_t pgid) {
+    return findIndexed(JOB_BY_PGID, pgid);
+}
+
+// Function to find a job by its number (%N)
+struct Job* findJobByNumber(struct Job* jobList, int number) {
+    return findIndexed(JOB_BY_NUMBER, number);
+}
+
+// Function to find a job by %N, %% / %+ (current job), the PID of a member or command name
+struct Job* findJobByPid(struct Job* jobList, char* identifier) {
+    if (identifier[0] == '%') {
+        if (identifier[1] == '%' || identifier[1] == '+' || identifier[1] == '\0') {
+            return tailJob;
+        }
+        return findJobByNumber(jobList, atoi(identifier + 1));
+    }
+
+    int numeric = (identifier[0] != '\0');
+    for (const char* c = identifier; *c != '\0' && numeric; c++) {
+        numeric = isdigit((unsigned char)*c);
+    }
+    if (numeric) {
+        return findJobByProcess(jobList, atoi(identifier));
+    }
+
+    // Names are not unique, the oldest job started with this command wins
+    for (struct Job* current = jobList; current != NULL; current = current->next) {
+        if (current->commands != NULL && strcmp(current->commands->words[0], identifier) == 0) {
+            return current;
+        }
+    }
+
+    return NULL;  // Job not found
+}
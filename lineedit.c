@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "bash_func.h"
+
+#define EDITOR_MIN_LINE 256 // First size of the line buffer
+
+#define KEY_CTRL_C 0x03
+#define KEY_CTRL_D 0x04
+#define KEY_CTRL_G 0x07
+#define KEY_BACKSPACE 0x08
+#define KEY_CTRL_R 0x12
+#define KEY_CTRL_U 0x15
+#define KEY_ESCAPE 0x1b
+#define KEY_DELETE 0x7f
+
+
+// Function to prepare a line editor for a terminal
+void initLineEditor(struct LineEditor* editor, int fd) {
+    editor->fd = fd;
+    editor->capacity = EDITOR_MIN_LINE;
+    editor->length = 0;
+    editor->pendingStart = 0;
+    editor->pendingEnd = 0;
+    editor->rawMode = 0;
+    editor->line = (char*)malloc(editor->capacity);
+
+    if (editor->line == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+}
+
+// Function to check whether keys were read ahead (e.g. pasted lines) and wait to be edited
+int keysPending(const struct LineEditor* editor) {
+    return editor->pendingStart < editor->pendingEnd;
+}
+
+// Function to get the next key byte, -1 at end of input
+static int nextKey(struct LineEditor* editor) {
+    if (!keysPending(editor)) {
+        ssize_t count;
+        do {
+            count = read(editor->fd, editor->pending, sizeof(editor->pending));
+        } while (count == -1 && errno == EINTR);
+
+        if (count <= 0) {
+            return -1;
+        }
+        editor->pendingStart = 0;
+        editor->pendingEnd = count;
+    }
+    return (unsigned char)editor->pending[editor->pendingStart++];
+}
+
+// Function to skip the rest of an escape sequence (arrow keys etc.), they are not bound.
+// A terminal sends the whole sequence at once, so it is already pending
+static void skipEscape(struct LineEditor* editor) {
+    int key = nextKey(editor);
+    if (key != '[' && key != 'O') {
+        return;
+    }
+    do {
+        key = nextKey(editor);
+    } while (key != -1 && (key < 0x40 || key > 0x7e));
+}
+
+// Function to make room for size bytes in the line buffer
+static void reserveLine(struct LineEditor* editor, size_t size) {
+    if (size <= editor->capacity) {
+        return;
+    }
+
+    while (size > editor->capacity) {
+        editor->capacity *= 2;
+    }
+    editor->line = (char*)realloc(editor->line, editor->capacity);
+    if (editor->line == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+}
+
+// Function to replace the edited line
+static void setLine(struct LineEditor* editor, const char* text, size_t length) {
+    reserveLine(editor, length + 1);
+    memcpy(editor->line, text, length);
+    editor->length = length;
+}
+
+// Function to add one byte at the end of the line (room for the '\0' is kept)
+static void appendKey(struct LineEditor* editor, char key) {
+    reserveLine(editor, editor->length + 2);
+    editor->line[editor->length++] = key;
+}
+
+// Function to draw the prompt and the line again on the current terminal row
+static void redrawLine(struct LineEditor* editor) {
+    printf("\r\033[K");
+    reprintPrompt();
+    fwrite(editor->line, 1, editor->length, stdout);
+    fflush(stdout);
+}
+
+// Function to draw the reverse search state in place of the prompt
+static void drawSearch(const char* pattern, const char* match, int failed) {
+    printf("\r\033[K(%sreverse-i-search)`%s': %s", failed ? "failed " : "", pattern, (match != NULL) ? match : "");
+    fflush(stdout);
+}
+
+// Function for CTRL + R: incremental search from the newest command back. Typing narrows
+// the search, CTRL + R again finds an older match, Enter runs the match, CTRL + G or
+// ESC gives the old line back and any other key keeps the match for editing.
+// Returns 1 when the line should be run
+static int reverseSearch(struct LineEditor* editor, const struct History* history) {
+    char pattern[256];
+    size_t patternLength = 0;
+    long match = -1;
+    int failed = 0;
+    pattern[0] = '\0';
+
+    drawSearch(pattern, NULL, 0);
+
+    while (1) {
+        int key = nextKey(editor);
+        long from = LONG_MAX;
+
+        if (key == KEY_CTRL_R) {
+            from = (match != -1) ? match : LONG_MAX;
+        } else if (key == KEY_DELETE || key == KEY_BACKSPACE) {
+            if (patternLength > 0) {
+                pattern[--patternLength] = '\0';
+            }
+        } else if (key >= 0x20 && patternLength + 1 < sizeof(pattern)) {
+            pattern[patternLength++] = key;
+            pattern[patternLength] = '\0';
+            from = (match != -1) ? match + 1 : LONG_MAX; // The current match may still fit
+        } else if (key == KEY_CTRL_G || key == KEY_CTRL_C || key == -1 ||
+                   (key == KEY_ESCAPE && !keysPending(editor))) {
+            redrawLine(editor);
+            return 0;
+        } else {
+            // Enter or another key (arrows too): leave the search with the match on the line
+            if (key == KEY_ESCAPE) {
+                skipEscape(editor);
+            }
+            if (match != -1) {
+                const char* text = historyEntry(history, match);
+                setLine(editor, text, strlen(text));
+            }
+            redrawLine(editor);
+            return key == '\r' || key == '\n';
+        }
+
+        if (patternLength > 0) {
+            long found = searchHistory(history, pattern, from);
+            failed = (found == -1);
+            if (!failed) {
+                match = found;
+            }
+        }
+        drawSearch(pattern, (match != -1) ? historyEntry(history, match) : NULL, failed);
+    }
+}
+
+// Function to switch the terminal to raw mode before the prompt waits for keys, so they
+// are neither echoed nor held back line by line. Output processing stays on
+void startEditing(struct LineEditor* editor) {
+    editor->rawMode = (tcgetattr(editor->fd, &editor->saved) == 0);
+    if (!editor->rawMode) {
+        return;
+    }
+
+    struct termios raw = editor->saved;
+    raw.c_lflag &= ~(ICANON | ECHO | ISIG | IEXTEN);
+    raw.c_iflag &= ~(ICRNL | IXON);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(editor->fd, TCSADRAIN, &raw);
+}
+
+// Function to give the terminal its settings back before commands run
+void stopEditing(struct LineEditor* editor) {
+    if (editor->rawMode) {
+        tcsetattr(editor->fd, TCSADRAIN, &editor->saved);
+        editor->rawMode = 0;
+    }
+}
+
+// Function to read one line after the prompt was printed, between startEditing() and
+// stopEditing(). CTRL + R searches the history, CTRL + U clears the line, CTRL + C drops it.
+// The result stays valid until the next call. Returns NULL at end of input (CTRL + D)
+char* editLine(struct LineEditor* editor, const struct History* history, size_t* length) {
+    editor->length = 0;
+    int done = 0;
+    int eof = 0;
+
+    while (!done) {
+        int key = nextKey(editor);
+
+        switch (key) {
+            case -1:
+                eof = 1;
+                done = 1;
+                break;
+            case '\r':
+            case '\n':
+                done = 1;
+                break;
+            case KEY_CTRL_D:
+                if (editor->length == 0) {
+                    eof = 1;
+                    done = 1;
+                }
+                break;
+            case KEY_CTRL_C:
+                printf("^C");
+                editor->length = 0;
+                done = 1;
+                break;
+            case KEY_DELETE:
+            case KEY_BACKSPACE:
+                if (editor->length > 0) {
+                    // A UTF-8 character goes as a whole
+                    do {
+                        editor->length--;
+                    } while (editor->length > 0 && (editor->line[editor->length] & 0xc0) == 0x80);
+                    printf("\b \b");
+                    fflush(stdout);
+                }
+                break;
+            case KEY_CTRL_U:
+                editor->length = 0;
+                redrawLine(editor);
+                break;
+            case KEY_CTRL_R:
+                done = reverseSearch(editor, history);
+                break;
+            case KEY_ESCAPE:
+                if (keysPending(editor)) {
+                    skipEscape(editor);
+                }
+                break;
+            default:
+                if (key >= 0x20) {
+                    appendKey(editor, key);
+                    putchar(key);
+                    fflush(stdout);
+                }
+                break;
+        }
+    }
+
+    if (eof) {
+        return NULL;
+    }
+
+    putchar('\n');
+    fflush(stdout);
+
+    editor->line[editor->length] = '\0';
+    *length = editor->length;
+    return editor->line;
+}
+
+// Function to free the editor's line buffer
+void freeLineEditor(struct LineEditor* editor) {
+    free(editor->line);
+    editor->line = NULL;
+}
@@ -0,0 +1,312 @@
+#define _GNU_SOURCE // memfd_create
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/pidfd.h>
+#include <unistd.h>
+
+#include "bash_func.h"
+
+#define MAX_PARALLEL 1024 // Upper bound for -j
+#define MAX_FAILED 101    // Exit status for this many failed commands or more
+
+
+// Structure Slot (one running command of 'parallel')
+struct Slot {
+    pid_t pid;  // 0 when the slot is free
+    int pidfd;  // Readable once the child ended, -1 without pidfd support
+    int output; // Buffered stdout of the child (memfd)
+    int errors; // Buffered stderr of the child (memfd)
+};
+
+// Structure CommandSource (where the command lines of 'parallel' come from)
+struct CommandSource {
+    char** prefix;             // Words put before every input
+    int prefixCount;
+    char** arguments;          // Inputs after ':::', NULL to read lines from stdin
+    struct LineReader* reader; // stdin lines
+    char* line;                // The current command line
+    size_t capacity;
+};
+
+
+// Function to get the next command line: the prefix words, then one input.
+// Returns NULL when the inputs are used up
+static char* nextCommandLine(struct CommandSource* source) {
+    const char* input;
+    size_t length;
+
+    if (source->arguments != NULL) {
+        input = *source->arguments;
+        if (input == NULL) {
+            return NULL;
+        }
+        source->arguments++;
+    } else {
+        do {
+            input = readLine(source->reader, &length);
+        } while (input != NULL && input[0] == '\0');
+        if (input == NULL) {
+            return NULL;
+        }
+    }
+
+    size_t needed = strlen(input) + 1;
+    for (int i = 0; i < source->prefixCount; i++) {
+        needed += strlen(source->prefix[i]) + 1;
+    }
+    if (needed > source->capacity) {
+        source->capacity = needed * 2;
+        source->line = (char*)realloc(source->line, source->capacity);
+        if (source->line == NULL) {
+            perror("Memory allocation");
+            exit(1);
+        }
+    }
+
+    char* end = source->line;
+    for (int i = 0; i < source->prefixCount; i++) {
+        end = stpcpy(end, source->prefix[i]);
+        *end++ = ' ';
+    }
+    strcpy(end, input);
+    return source->line;
+}
+
+// Function to copy a child's buffered output to fd and free the buffer
+static void flushOutput(int buffer, int fd) {
+    off_t size = lseek(buffer, 0, SEEK_END);
+    char chunk[65536];
+    off_t offset = 0;
+
+    while (offset < size) {
+        ssize_t count = pread(buffer, chunk, sizeof(chunk), offset);
+        if (count <= 0) {
+            break;
+        }
+        for (ssize_t written = 0; written < count;) {
+            ssize_t result = write(fd, chunk + written, count - written);
+            if (result == -1 && errno != EINTR) {
+                close(buffer);
+                return; // Reader is gone, the output is dropped
+            }
+            written += (result > 0) ? result : 0;
+        }
+        offset += count;
+    }
+    close(buffer);
+}
+
+// Function to create an anonymous buffer for a child's output
+static int outputBuffer() {
+    int fd = memfd_create("parallel", MFD_CLOEXEC);
+    if (fd == -1) {
+        perror("memfd_create");
+    }
+    return fd;
+}
+
+// Function to start one command line in a free slot: parsed here, run with stdin from
+// input (/dev/null) and the output going to the slot's buffers. A simple command is
+// spawned like any other, only lists and pipelines need a forked shell.
+// Returns 0 when started, else the command's exit status
+static int startCommand(struct Slot* slot, int epollFd, int index, int input, struct Arena* arena, char* line,
+                        struct Job** jobList, struct History** historyList) {
+    int tokenCount;
+    struct Token* tokens = splitStringWithoutSpaces(arena, line, &tokenCount);
+    struct Ast* ast = (tokenCount > 0) ? parseCommandsFromWords(arena, tokens, tokenCount) : NULL;
+    if (ast == NULL) {
+        return (tokenCount > 0) ? 2 : 0;
+    }
+
+    slot->output = outputBuffer();
+    slot->errors = (slot->output != -1) ? outputBuffer() : -1;
+    if (slot->errors == -1) {
+        if (slot->output != -1) {
+            close(slot->output);
+        }
+        return 1;
+    }
+
+    fflush(stdout); // Children must not inherit unflushed output
+    fflush(stderr);
+    struct Node* root = &ast->nodes[ast->root];
+    pid_t pid;
+    if (root->type == NODE_COMMAND) {
+        pid = spawnCommand(root->cmd, -1, -1, input, slot->output, slot->errors, jobList, historyList);
+    } else {
+        pid = forkChild(-1);
+        if (pid == 0) {
+            dup2(input, STDIN_FILENO);
+            dup2(slot->output, STDOUT_FILENO);
+            dup2(slot->errors, STDERR_FILENO);
+            exit(executeNode(ast, ast->root, jobList, historyList));
+        }
+    }
+
+    if (pid < 0) {
+        close(slot->output);
+        close(slot->errors);
+        return (pid == SPAWN_REDIRECT_FAILED) ? 1 : 127;
+    }
+
+    slot->pid = pid;
+    slot->pidfd = pidfd_open(pid, 0);
+    if (slot->pidfd != -1) {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u32 = index;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, slot->pidfd, &event);
+    }
+    return 0;
+}
+
+// Function to collect an ended child: its output is printed as one block.
+// Returns its exit status
+static int finishCommand(struct Slot* slot, int epollFd) {
+    int status = 0;
+    while (waitpid(slot->pid, &status, 0) == -1 && errno == EINTR) {
+    }
+
+    if (slot->pidfd != -1) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, slot->pidfd, NULL);
+        close(slot->pidfd);
+    }
+    flushOutput(slot->output, STDOUT_FILENO);
+    flushOutput(slot->errors, STDERR_FILENO);
+    slot->pid = 0;
+
+    if (WIFSIGNALED(status)) {
+        return 128 + WTERMSIG(status);
+    }
+    return WEXITSTATUS(status);
+}
+
+// Function to wait for the next child to end, returns its slot.
+// Without pidfds the oldest running child is waited for
+static int waitForSlot(struct Slot* slots, int count, int epollFd) {
+    struct epoll_event event;
+    if (epollFd != -1) {
+        for (int i = 0; i < count; i++) {
+            if (slots[i].pid != 0 && slots[i].pidfd == -1) {
+                return i; // Cannot be watched
+            }
+        }
+        int ready;
+        while ((ready = epoll_wait(epollFd, &event, 1, -1)) == -1 && errno == EINTR) {
+        }
+        if (ready == 1 && slots[event.data.u32].pid != 0) {
+            return event.data.u32;
+        }
+        if (ready == -1) {
+            perror("epoll_wait");
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (slots[i].pid != 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Function for 'parallel': run command lines with at most jobs of them at once. A new
+// one starts as soon as a running one ends (its pidfd becomes readable). Each command's
+// stdout and stderr are buffered and printed together when it ends, so outputs never mix.
+// Command lines are the prefix words + one input: a word after ':::', else a line of stdin.
+// Returns 0 when all succeeded, else the number of failed commands (at most 101)
+int runParallel(long jobs, char** prefix, int prefixCount, char** arguments,
+                struct Job** jobList, struct History** historyList) {
+    if (jobs < 1 || jobs > MAX_PARALLEL) {
+        fprintf(stderr, "bash: parallel: -j: %ld: must be 1 to %d\n", jobs, MAX_PARALLEL);
+        return 2;
+    }
+
+    struct Slot* slots = (struct Slot*)calloc(jobs, sizeof(struct Slot));
+    if (slots == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+
+    int input = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (input == -1) {
+        perror("/dev/null");
+        free(slots);
+        return 1;
+    }
+
+    struct Arena arena;
+    struct LineReader reader;
+    struct CommandSource source = {prefix, prefixCount, arguments, NULL, NULL, 0};
+    if (arguments == NULL) {
+        initLineReader(&reader, STDIN_FILENO);
+        source.reader = &reader;
+    }
+
+    initArena(&arena);
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    int running = 0;
+    int failed = 0;
+    int done = 0; // No more command lines, or CTRL + C: start no more
+
+    while (1) {
+        // Fill the free slots, then wait for one to free up
+        int slot = 0;
+        while (!done && running < jobs) {
+            char* line = nextCommandLine(&source);
+            if (line == NULL) {
+                done = 1;
+                break;
+            }
+
+            while (slots[slot].pid != 0) {
+                slot++;
+            }
+            int status = startCommand(&slots[slot], epollFd, slot, input, &arena, line, jobList, historyList);
+            resetArena(&arena); // The child has its own copy
+            if (slots[slot].pid != 0) {
+                running++;
+            } else if (status != 0) {
+                failed++;
+            }
+        }
+
+        if (running == 0) {
+            break;
+        }
+
+        int index = waitForSlot(slots, jobs, epollFd);
+        if (index == -1) {
+            break;
+        }
+        int status = finishCommand(&slots[index], epollFd);
+        running--;
+        if (status != 0) {
+            failed++;
+        }
+        if (status == 128 + SIGINT) {
+            done = 1; // Let the running ones end
+        }
+    }
+
+    if (epollFd != -1) {
+        close(epollFd);
+    }
+    close(input);
+    if (source.reader != NULL) {
+        freeLineReader(source.reader);
+    }
+    freeArena(&arena);
+    free(source.line);
+    free(slots);
+
+    return (failed > MAX_FAILED) ? MAX_FAILED : failed;
+}
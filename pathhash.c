@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bash_func.h"
+
+#define PATH_HASH_BUCKETS 64            // Hash buckets (power of two)
+#define DEFAULT_PATH "/bin:/usr/bin"    // Search path when PATH is unset, as execvp uses
+
+
+// Structure PathEntry (one remembered command)
+struct PathEntry {
+    unsigned int hash;       // Hash of the name
+    int hits;                // Times the path was used
+    char* path;              // Absolute path, stored after the name
+    struct PathEntry* chain; // Next entry in the bucket
+    char name[];             // Command name
+};
+
+static struct PathEntry* buckets[PATH_HASH_BUCKETS];
+static char* hashedPath = NULL; // PATH the entries were resolved against
+
+
+// Function to get the current search path
+static const char* searchPath() {
+    const char* path = getenv("PATH");
+    return (path != NULL) ? path : DEFAULT_PATH;
+}
+
+// Function to forget every remembered path
+void clearCommandPaths() {
+    for (int i = 0; i < PATH_HASH_BUCKETS; i++) {
+        struct PathEntry* entry = buckets[i];
+        while (entry != NULL) {
+            struct PathEntry* next = entry->chain;
+            free(entry);
+            entry = next;
+        }
+        buckets[i] = NULL;
+    }
+
+    free(hashedPath);
+    hashedPath = NULL;
+}
+
+// Function to drop all entries when PATH is not the one they were resolved against
+static void checkSearchPath() {
+    const char* path = searchPath();
+    if (hashedPath != NULL && strcmp(hashedPath, path) == 0) {
+        return;
+    }
+
+    clearCommandPaths();
+    hashedPath = strdup(path);
+    if (hashedPath == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+}
+
+// Function to search PATH once, writes the executable's path into result
+static int searchCommand(const char* name, char* result, size_t size) {
+    const char* dir = searchPath();
+
+    while (1) {
+        const char* end = strchr(dir, ':');
+        size_t length = (end != NULL) ? (size_t)(end - dir) : strlen(dir);
+
+        // An empty PATH element means the current directory
+        int written = (length == 0) ? snprintf(result, size, "./%s", name)
+                                    : snprintf(result, size, "%.*s/%s", (int)length, dir, name);
+
+        struct stat st;
+        if (written > 0 && (size_t)written < size &&
+            stat(result, &st) == 0 && S_ISREG(st.st_mode) && access(result, X_OK) == 0) {
+            return 1;
+        }
+
+        if (end == NULL) {
+            return 0;
+        }
+        dir = end + 1;
+    }
+}
+
+// Function to find a remembered entry
+static struct PathEntry* findEntry(const char* name, unsigned int hash) {
+    for (struct PathEntry* entry = buckets[hash & (PATH_HASH_BUCKETS - 1)]; entry != NULL; entry = entry->chain) {
+        if (entry->hash == hash && strcmp(entry->name, name) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Function to resolve a name through PATH and remember it, returns NULL when not found
+static struct PathEntry* addEntry(const char* name, unsigned int hash) {
+    char path[4096];
+    if (!searchCommand(name, path, sizeof(path))) {
+        return NULL;
+    }
+
+    size_t nameLength = strlen(name) + 1;
+    size_t pathLength = strlen(path) + 1;
+    struct PathEntry* entry = (struct PathEntry*)malloc(sizeof(struct PathEntry) + nameLength + pathLength);
+    if (entry == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+
+    entry->hash = hash;
+    entry->hits = 0;
+    memcpy(entry->name, name, nameLength);
+    entry->path = entry->name + nameLength;
+    memcpy(entry->path, path, pathLength);
+
+    entry->chain = buckets[hash & (PATH_HASH_BUCKETS - 1)];
+    buckets[hash & (PATH_HASH_BUCKETS - 1)] = entry;
+
+    return entry;
+}
+
+// Function to get the executable for a command name: names with a '/' are used as they
+// are, others come from the table or a single PATH search. Returns NULL when not found
+const char* lookupCommandPath(const char* name) {
+    if (strchr(name, '/') != NULL) {
+        return name;
+    }
+
+    checkSearchPath();
+
+    unsigned int hash = hashBytes(name, strlen(name));
+    struct PathEntry* entry = findEntry(name, hash);
+    if (entry == NULL) {
+        entry = addEntry(name, hash);
+        if (entry == NULL) {
+            return NULL;
+        }
+    }
+
+    entry->hits++;
+    return entry->path;
+}
+
+// Function to drop one entry, e.g. after its file disappeared
+void forgetCommandPath(const char* name) {
+    unsigned int hash = hashBytes(name, strlen(name));
+    struct PathEntry** link = &buckets[hash & (PATH_HASH_BUCKETS - 1)];
+
+    while (*link != NULL) {
+        if ((*link)->hash == hash && strcmp((*link)->name, name) == 0) {
+            struct PathEntry* entry = *link;
+            *link = entry->chain;
+            free(entry);
+            return;
+        }
+        link = &(*link)->chain;
+    }
+}
+
+// Function to (re)resolve a name for 'hash name', returns 0 when it was not found
+int rememberCommandPath(const char* name) {
+    checkSearchPath();
+    forgetCommandPath(name);
+    return addEntry(name, hashBytes(name, strlen(name))) != NULL;
+}
+
+// Function for printing the table like 'hash' does
+void printCommandPaths() {
+    int empty = 1;
+    checkSearchPath();
+
+    for (int i = 0; i < PATH_HASH_BUCKETS; i++) {
+        for (struct PathEntry* entry = buckets[i]; entry != NULL; entry = entry->chain) {
+            if (empty) {
+                printf("hits\tcommand\n");
+                empty = 0;
+            }
+            printf("%4d\t%s\n", entry->hits, entry->path);
+        }
+    }
+
+    if (empty) {
+        printf("hash: hash table empty\n");
+    }
+}
@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bash_func.h"
+
+#define MIN_PATH_SIZE 256 // First buffer size for getcwd, doubled for deeper paths
+#define MAX_SEGMENTS 64   // Parts of a PS1 string
+#define DEFAULT_PS1 "\\[\\e[1;34m\\]\\w\\[\\e[0m\\]\\$ "
+
+// Prompt inputs, a segment is only computed again when its input changed
+#define INPUT_CWD 1
+#define INPUT_JOBS 2
+#define INPUT_STATUS 4
+#define INPUT_DURATION 8
+
+// Segment types
+#define SEGMENT_TEXT 0     // Fixed text
+#define SEGMENT_CWD 1      // \w: current directory, $HOME shown as ~
+#define SEGMENT_BASENAME 2 // \W: last part of the current directory
+#define SEGMENT_JOBS 3     // \j: number of jobs
+#define SEGMENT_STATUS 4   // \?: exit status of the last command
+#define SEGMENT_DURATION 5 // \L: wall time of the last command
+
+
+// Structure Segment (one part of the prompt)
+struct Segment {
+    int type;
+    char* text; // Fixed text (SEGMENT_TEXT)
+};
+
+// Current directory, read once and again only when it changes
+static char* directory = NULL;
+static unsigned long directoryVersion = 0;
+
+// Parsed PS1
+static char* promptSource = NULL;
+static struct Segment segments[MAX_SEGMENTS];
+static int segmentCount = 0;
+static int promptInputs = 0; // INPUT_* flags the segments depend on
+
+// Rendered prompt and the inputs it was rendered with
+static char* rendered = NULL;
+static size_t renderedLength = 0;
+static size_t renderedCapacity = 0;
+static int valid = 0;
+static unsigned long renderedDirectory;
+static int renderedJobs;
+static int renderedStatus;
+static long renderedDuration;
+
+
+// Function to read the current directory into the cache, any path length.
+// When it cannot be read (e.g. it was removed) the old path is kept
+void refreshDirectory() {
+    size_t size = MIN_PATH_SIZE;
+    char* path = NULL;
+
+    while (1) {
+        path = (char*)realloc(path, size);
+        if (path == NULL) {
+            perror("Memory allocation");
+            exit(1);
+        }
+        if (getcwd(path, size) != NULL) {
+            break;
+        }
+        if (errno != ERANGE) {
+            free(path);
+            return;
+        }
+        size *= 2;
+    }
+
+    if (directory == NULL || strcmp(directory, path) != 0) {
+        directoryVersion++;
+    }
+    free(directory);
+    directory = path;
+}
+
+// Function to get the cached current directory
+const char* currentDirectory() {
+    if (directory == NULL) {
+        refreshDirectory();
+    }
+    return (directory != NULL) ? directory : ".";
+}
+
+// Function to check the cached directory against the real one, for when it may be stale
+// (the directory was moved or removed). Refreshes it when they differ
+void checkDirectory() {
+    struct stat cached;
+    struct stat current;
+
+    if (directory == NULL || stat(".", &current) == -1 || stat(directory, &cached) == -1 ||
+        cached.st_dev != current.st_dev || cached.st_ino != current.st_ino) {
+        refreshDirectory();
+    }
+}
+
+
+// Function to add fixed text to the parsed prompt
+static void addText(const char* text, size_t length) {
+    if (length == 0 || segmentCount == MAX_SEGMENTS) {
+        return;
+    }
+
+    segments[segmentCount].type = SEGMENT_TEXT;
+    segments[segmentCount].text = strndup(text, length);
+    if (segments[segmentCount].text == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+    segmentCount++;
+}
+
+// Function to add a computed segment to the parsed prompt
+static void addSegment(int type, int input) {
+    if (segmentCount == MAX_SEGMENTS) {
+        return;
+    }
+
+    segments[segmentCount].type = type;
+    segments[segmentCount].text = NULL;
+    segmentCount++;
+    promptInputs |= input;
+}
+
+// Function to split a PS1 string into segments. Escapes that never change (\u, \h, \$,
+// \e, \n) become fixed text here, once
+static void parsePrompt(const char* source) {
+    for (int i = 0; i < segmentCount; i++) {
+        free(segments[i].text);
+    }
+    segmentCount = 0;
+    promptInputs = 0;
+
+    free(promptSource);
+    promptSource = strdup(source);
+    if (promptSource == NULL) {
+        perror("Memory allocation");
+        exit(1);
+    }
+
+    const char* text = source;
+    const char* c = source;
+    while (*c != '\0') {
+        if (*c != '\\' || c[1] == '\0') {
+            c++;
+            continue;
+        }
+
+        addText(text, c - text);
+        char escape = c[1];
+        c += 2;
+        text = c;
+
+        char host[256];
+        const char* user;
+        switch (escape) {
+            case 'w':
+                addSegment(SEGMENT_CWD, INPUT_CWD);
+                break;
+            case 'W':
+                addSegment(SEGMENT_BASENAME, INPUT_CWD);
+                break;
+            case 'j':
+                addSegment(SEGMENT_JOBS, INPUT_JOBS);
+                break;
+            case '?':
+                addSegment(SEGMENT_STATUS, INPUT_STATUS);
+                break;
+            case 'L':
+                addSegment(SEGMENT_DURATION, INPUT_DURATION);
+                break;
+            case 'u':
+                user = getenv("USER");
+                addText((user != NULL) ? user : "", (user != NULL) ? strlen(user) : 0);
+                break;
+            case 'h':
+                if (gethostname(host, sizeof(host)) == 0) {
+                    host[sizeof(host) - 1] = '\0';
+                    addText(host, strcspn(host, "."));
+                }
+                break;
+            case '$':
+                addText((geteuid() == 0) ? "#" : "$", 1);
+                break;
+            case 'e':
+                addText("\033", 1);
+                break;
+            case 'n':
+                addText("\n", 1);
+                break;
+            case '[':
+            case ']':
+                break; // Non-printing markers, nothing to show
+            default:
+                addText(c - 2, 2); // Unknown escapes are shown as they are
+                break;
+        }
+    }
+    addText(text, c - text);
+
+    valid = 0;
+}
+
+// Function to append text to the rendered prompt
+static void appendRendered(const char* text, size_t length) {
+    if (renderedLength + length + 1 > renderedCapacity) {
+        renderedCapacity = (renderedCapacity == 0) ? MIN_PATH_SIZE : renderedCapacity;
+        while (renderedLength + length + 1 > renderedCapacity) {
+            renderedCapacity *= 2;
+        }
+        rendered = (char*)realloc(rendered, renderedCapacity);
+        if (rendered == NULL) {
+            perror("Memory allocation");
+            exit(1);
+        }
+    }
+
+    memcpy(rendered + renderedLength, text, length);
+    renderedLength += length;
+    rendered[renderedLength] = '\0';
+}
+
+// Function to build the prompt text from the segments
+static void renderPrompt(int jobCount, int status, long durationUs) {
+    renderedLength = 0;
+    appendRendered("", 0);
+
+    for (int i = 0; i < segmentCount; i++) {
+        char number[32];
+        const char* cwd;
+        const char* home;
+        const char* base;
+
+        switch (segments[i].type) {
+            case SEGMENT_TEXT:
+                appendRendered(segments[i].text, strlen(segments[i].text));
+                break;
+            case SEGMENT_CWD:
+                cwd = currentDirectory();
+                home = getenv("HOME");
+                if (home != NULL && home[0] != '\0' && home[1] != '\0' &&
+                    strncmp(cwd, home, strlen(home)) == 0 &&
+                    (cwd[strlen(home)] == '\0' || cwd[strlen(home)] == '/')) {
+                    appendRendered("~", 1);
+                    cwd += strlen(home);
+                }
+                appendRendered(cwd, strlen(cwd));
+                break;
+            case SEGMENT_BASENAME:
+                cwd = currentDirectory();
+                base = strrchr(cwd, '/');
+                base = (base != NULL && base[1] != '\0') ? base + 1 : cwd;
+                appendRendered(base, strlen(base));
+                break;
+            case SEGMENT_JOBS:
+                appendRendered(number, snprintf(number, sizeof(number), "%d", jobCount));
+                break;
+            case SEGMENT_STATUS:
+                appendRendered(number, snprintf(number, sizeof(number), "%d", status));
+                break;
+            case SEGMENT_DURATION:
+                if (durationUs < 1000000) {
+                    appendRendered(number, snprintf(number, sizeof(number), "%ldms", durationUs / 1000));
+                } else {
+                    appendRendered(number, snprintf(number, sizeof(number), "%.1fs", durationUs / 1e6));
+                }
+                break;
+        }
+    }
+
+    valid = 1;
+    renderedDirectory = directoryVersion;
+    renderedJobs = jobCount;
+    renderedStatus = status;
+    renderedDuration = durationUs;
+}
+
+// Function to print the prompt from PS1 (default: the current directory in blue and '$').
+// It is rendered again only when PS1 or an input one of its segments shows has changed
+void printPrompt(int jobCount, int status, long durationUs) {
+    const char* source = getenv("PS1");
+    if (source == NULL) {
+        source = DEFAULT_PS1;
+    }
+    if (promptSource == NULL || strcmp(promptSource, source) != 0) {
+        parsePrompt(source);
+    }
+    if (directory == NULL && (promptInputs & INPUT_CWD)) {
+        refreshDirectory();
+    }
+
+    if (!valid ||
+        ((promptInputs & INPUT_CWD) && renderedDirectory != directoryVersion) ||
+        ((promptInputs & INPUT_JOBS) && renderedJobs != jobCount) ||
+        ((promptInputs & INPUT_STATUS) && renderedStatus != status) ||
+        ((promptInputs & INPUT_DURATION) && renderedDuration != durationUs)) {
+        renderPrompt(jobCount, status, durationUs);
+    }
+
+    fwrite(rendered, 1, renderedLength, stdout);
+}
+
+// Function to print the last prompt again, e.g. when the line editor redraws the line
+void reprintPrompt() {
+    if (rendered != NULL) {
+        fwrite(rendered, 1, renderedLength, stdout);
+    }
+}
@@ -0,0 +1,232 @@
+#define _GNU_SOURCE // posix_spawn_file_actions_addtcsetpgrp_np
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <spawn.h>
+
+#include "bash_func.h"
+
+
+extern char** environ;
+
+// Signals the shell ignores or handles, children get them back at default
+static const int childSignals[] = {
+    SIGINT, SIGTSTP, SIGTERM, SIGQUIT, SIGHUP, SIGCONT, SIGTTOU, SIGTTIN, SIGCHLD
+};
+
+#define CHILD_SIGNAL_COUNT (int)(sizeof(childSignals) / sizeof(childSignals[0]))
+
+
+// Function to restore default signal handling and an empty mask in a forked child
+static void resetChildSignals() {
+    sigset_t empty;
+    sigemptyset(&empty);
+
+    for (int i = 0; i < CHILD_SIGNAL_COUNT; i++) {
+        signal(childSignals[i], SIG_DFL);
+    }
+    sigprocmask(SIG_SETMASK, &empty, NULL);
+}
+
+// Function to fork a child that runs shell code (builtins, subshells).
+// pgid: -1 keeps the shell's group, 0 makes the child a group leader, >0 joins that group
+pid_t forkChild(pid_t pgid) {
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        return -1;
+    }
+
+    if (pid == 0) {
+        resetChildSignals();
+        closeEventLoop();
+        closeJobDescriptors();
+        if (pgid != -1) {
+            setpgid(0, pgid);
+        }
+    } else if (pgid != -1) {
+        setpgid(pid, pgid == 0 ? pid : pgid); // Both sides set it, whichever runs first wins
+    }
+
+    return pid;
+}
+
+
+// Function to close the shell's fds in a forked builtin child, e.g. the pipe ends of
+// other stages: exec would have closed them, and a pipe whose read end the child still
+// held would never report a gone reader. A builtin needs none of them, only the trace fd
+static void closeShellFds() {
+    int keep = traceDescriptor();
+    if (keep > STDERR_FILENO) {
+        close_range(STDERR_FILENO + 1, keep - 1, 0);
+        close_range(keep + 1, ~0U, 0);
+    } else {
+        close_range(STDERR_FILENO + 1, ~0U, 0);
+    }
+}
+
+// Function to finish a forked child: apply redirections, then run the builtin in the
+// child or exec the program. Never returns
+static void runInChild(struct Command* cmd, struct Job** jobList, struct History** historyList) {
+    if (applyRedirects(cmd) == -1) {
+        exit(EXIT_FAILURE);
+    }
+
+    struct Builtin* builtin = findBuiltin(cmd->words[0]);
+    if (builtin != NULL) {
+        exit(builtin->function(cmd, jobList, historyList));
+    }
+
+    execvp(cmd->words[0], cmd->words);
+    perror("execvp");
+    exit(127);
+}
+
+// Function to describe the child's fds: terminal ownership, then stdin/stdout/stderr
+static int addFileActions(posix_spawn_file_actions_t* actions, int terminalFd, int inputFd, int outputFd,
+                          int errorFd) {
+    int error = 0;
+
+    if (terminalFd != -1) {
+        // Done in the child before exec, so it cannot touch the terminal too early
+        error = posix_spawn_file_actions_addtcsetpgrp_np(actions, terminalFd);
+    }
+    if (error == 0 && inputFd != -1) {
+        error = posix_spawn_file_actions_adddup2(actions, inputFd, STDIN_FILENO);
+    }
+    if (error == 0 && outputFd != -1) {
+        error = posix_spawn_file_actions_adddup2(actions, outputFd, STDOUT_FILENO);
+    }
+    if (error == 0 && errorFd != -1) {
+        error = posix_spawn_file_actions_adddup2(actions, errorFd, STDERR_FILENO);
+    }
+
+    return error;
+}
+
+// Function to launch one command as a child process without copying the shell's address space.
+// pgid: -1 keeps the shell's group, 0 makes the child a group leader, >0 joins that group.
+// terminalFd: when not -1 the new group becomes the foreground group of that terminal.
+// inputFd/outputFd/errorFd are placed on stdin/stdout/stderr when not -1; other pipe ends
+// must be close-on-exec.
+// Builtins need the shell's code in the child, so only they fall back to fork; that child
+// closes the shell's other fds itself.
+// Returns the child's pid, SPAWN_REDIRECT_FAILED when a redirection failed, or SPAWN_FAILED
+pid_t spawnCommand(struct Command* cmd, pid_t pgid, int terminalFd, int inputFd, int outputFd, int errorFd,
+                   struct Job** jobList, struct History** historyList) {
+    long spawnStart = traceClock();
+
+    if (findBuiltin(cmd->words[0]) != NULL) {
+        pid_t pid = forkChild(pgid);
+        if (pid > 0) {
+            tracePhase("fork", spawnStart, pid);
+        }
+        if (pid == 0) {
+            if (inputFd != -1) {
+                dup2(inputFd, STDIN_FILENO);
+                close(inputFd);
+            }
+            if (outputFd != -1) {
+                dup2(outputFd, STDOUT_FILENO);
+                close(outputFd);
+            }
+            if (errorFd != -1) {
+                dup2(errorFd, STDERR_FILENO);
+                close(errorFd);
+            }
+            closeShellFds();
+            runInChild(cmd, jobList, historyList);
+        }
+        return pid;
+    }
+
+    // Resolved in the parent from the PATH table: unknown commands never reach a child
+    const char* path = lookupCommandPath(cmd->words[0]);
+    if (path == NULL) {
+        fprintf(stderr, "bash: %s: command not found\n", cmd->words[0]);
+        return -1;
+    }
+
+    // Redirections are opened here, so a bad file is reported before anything is started.
+    // They replace the pipe ends, as the last dup2 would in the child
+    int redirectInput;
+    int redirectOutput;
+    if (openRedirects(cmd, &redirectInput, &redirectOutput) == -1) {
+        return SPAWN_REDIRECT_FAILED;
+    }
+    if (redirectInput != -1) {
+        inputFd = redirectInput;
+    }
+    if (redirectOutput != -1) {
+        outputFd = redirectOutput;
+    }
+
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_t actions;
+    sigset_t defaults;
+    sigset_t empty;
+    short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+
+    sigemptyset(&defaults);
+    for (int i = 0; i < CHILD_SIGNAL_COUNT; i++) {
+        sigaddset(&defaults, childSignals[i]);
+    }
+    sigemptyset(&empty);
+
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setsigmask(&attr, &empty);
+    if (pgid != -1) {
+        flags |= POSIX_SPAWN_SETPGROUP;
+        posix_spawnattr_setpgroup(&attr, pgid);
+    }
+    posix_spawnattr_setflags(&attr, flags);
+
+    posix_spawn_file_actions_init(&actions);
+
+    // The parent waits in posix_spawn until the child has called exec: "spawn" is the
+    // shell's setup, "exec" the time until the program runs
+    pid_t pid;
+    long execStart = traceClock();
+    int error = addFileActions(&actions, terminalFd, inputFd, outputFd, errorFd);
+    if (error == 0) {
+        execStart = traceClock();
+        error = posix_spawn(&pid, path, &actions, &attr, cmd->words, environ);
+
+        // The remembered file is gone: search PATH again once
+        if (error == ENOENT && path != cmd->words[0]) {
+            forgetCommandPath(cmd->words[0]);
+            path = lookupCommandPath(cmd->words[0]);
+            if (path != NULL) {
+                error = posix_spawn(&pid, path, &actions, &attr, cmd->words, environ);
+            }
+        }
+    }
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+
+    if (redirectInput != -1) {
+        close(redirectInput);
+    }
+    if (redirectOutput != -1) {
+        close(redirectOutput);
+    }
+
+    if (error != 0) {
+        fprintf(stderr, "bash: %s: %s\n", cmd->words[0], strerror(error));
+        return -1;
+    }
+
+    if (tracingEnabled()) {
+        long execEnd = traceClock();
+        traceSpan("spawn", spawnStart, execStart, pid);
+        traceSpan("exec", execStart, execEnd, pid);
+    }
+    return pid;
+}
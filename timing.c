@@ -0,0 +1,147 @@
+#define _DEFAULT_SOURCE // timeradd, timersub
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "bash_func.h"
+
+#define STAGE_NAME_SIZE 64 // Command text kept per timed stage
+
+
+// Structure TimedStage (resource use of one reaped foreground process)
+struct TimedStage {
+    char name[STAGE_NAME_SIZE]; // Stage command line, shortened
+    pid_t pid;
+    struct rusage usage;        // From wait4
+};
+
+// Stages reaped while 'time' runs, for every timed list that is active
+static struct TimedStage* stages = NULL;
+static int stageCount = 0;
+static int stageCapacity = 0;
+static int timingDepth = 0; // Nested 'time' lists running
+
+
+// Function to check whether a 'time' list is running, so stages should be recorded
+int timingActive() {
+    return timingDepth > 0;
+}
+
+// Function to record the resource use of a reaped stage; cmd may be NULL when the
+// stage's command is not known
+void recordStage(const struct Command* cmd, pid_t pid, const struct rusage* usage) {
+    if (stageCount == stageCapacity) {
+        stageCapacity = (stageCapacity == 0) ? 8 : stageCapacity * 2;
+        stages = (struct TimedStage*)realloc(stages, stageCapacity * sizeof(struct TimedStage));
+        if (stages == NULL) {
+            perror("Memory allocation");
+            exit(1);
+        }
+    }
+
+    struct TimedStage* stage = &stages[stageCount++];
+    stage->pid = pid;
+    stage->usage = *usage;
+    stage->name[0] = '\0';
+
+    // Words joined with spaces, cut to the buffer
+    size_t length = 0;
+    for (int i = 0; cmd != NULL && cmd->words[i] != NULL && length + 1 < STAGE_NAME_SIZE; i++) {
+        length += snprintf(stage->name + length, STAGE_NAME_SIZE - length, (i > 0) ? " %s" : "%s", cmd->words[i]);
+    }
+}
+
+static double seconds(const struct timeval* tv) {
+    return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+// Function to subtract two getrusage() readings, the counters this report uses
+static void usageSince(struct rusage* result, const struct rusage* after, const struct rusage* before) {
+    timersub(&after->ru_utime, &before->ru_utime, &result->ru_utime);
+    timersub(&after->ru_stime, &before->ru_stime, &result->ru_stime);
+    result->ru_minflt = after->ru_minflt - before->ru_minflt;
+    result->ru_majflt = after->ru_majflt - before->ru_majflt;
+    result->ru_nvcsw = after->ru_nvcsw - before->ru_nvcsw;
+    result->ru_nivcsw = after->ru_nivcsw - before->ru_nivcsw;
+}
+
+// Function to add the counters of one reading to another
+static void addUsage(struct rusage* total, const struct rusage* usage) {
+    timeradd(&total->ru_utime, &usage->ru_utime, &total->ru_utime);
+    timeradd(&total->ru_stime, &usage->ru_stime, &total->ru_stime);
+    total->ru_minflt += usage->ru_minflt;
+    total->ru_majflt += usage->ru_majflt;
+    total->ru_nvcsw += usage->ru_nvcsw;
+    total->ru_nivcsw += usage->ru_nivcsw;
+}
+
+// Function to run a list prefixed by 'time' and report to stderr: wall time, CPU time of
+// the shell and its children, max RSS, page faults and context switches, then every
+// stage on its own when more than one process ran
+int executeTimed(struct Ast* ast, int index, struct Job** jobList, struct History** historyList) {
+    struct timespec start;
+    struct timespec end;
+    struct rusage selfBefore;
+    struct rusage childrenBefore;
+    int firstStage = stageCount;
+
+    getrusage(RUSAGE_SELF, &selfBefore);
+    getrusage(RUSAGE_CHILDREN, &childrenBefore);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    timingDepth++;
+    int status = executeNode(ast, index, jobList, historyList);
+    timingDepth--;
+
+    struct rusage selfAfter;
+    struct rusage childrenAfter;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    getrusage(RUSAGE_SELF, &selfAfter);
+    getrusage(RUSAGE_CHILDREN, &childrenAfter);
+
+    // Builtins run in the shell, so its own use is counted too
+    struct rusage total;
+    struct rusage children;
+    usageSince(&total, &selfAfter, &selfBefore);
+    usageSince(&children, &childrenAfter, &childrenBefore);
+    addUsage(&total, &children);
+
+    // Nothing forked: a builtin ran in the shell, whose peak is the only one there is
+    long maxRss = (stageCount == firstStage) ? selfAfter.ru_maxrss : 0;
+    for (int i = firstStage; i < stageCount; i++) {
+        if (stages[i].usage.ru_maxrss > maxRss) {
+            maxRss = stages[i].usage.ru_maxrss;
+        }
+    }
+
+    double wall = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "\nreal\t%dm%.3fs\n", (int)(wall / 60), wall - 60 * (int)(wall / 60));
+    fprintf(stderr, "user\t%dm%.3fs\n", (int)(seconds(&total.ru_utime) / 60),
+            seconds(&total.ru_utime) - 60 * (int)(seconds(&total.ru_utime) / 60));
+    fprintf(stderr, "sys\t%dm%.3fs\n", (int)(seconds(&total.ru_stime) / 60),
+            seconds(&total.ru_stime) - 60 * (int)(seconds(&total.ru_stime) / 60));
+    fprintf(stderr, "maxrss\t%ld KB\n", maxRss);
+    fprintf(stderr, "faults\t%ld minor, %ld major\n", total.ru_minflt, total.ru_majflt);
+    fprintf(stderr, "ctxsw\t%ld voluntary, %ld involuntary\n", total.ru_nvcsw, total.ru_nivcsw);
+
+    if (stageCount - firstStage > 1) {
+        fprintf(stderr, "%-6s %-8s %9s %9s %10s %8s %8s %8s %8s  %s\n",
+                "stage", "pid", "user(s)", "sys(s)", "maxrss(KB)", "minflt", "majflt", "vcsw", "ivcsw", "command");
+        for (int i = firstStage; i < stageCount; i++) {
+            const struct rusage* usage = &stages[i].usage;
+            fprintf(stderr, "%-6d %-8d %9.3f %9.3f %10ld %8ld %8ld %8ld %8ld  %s\n",
+                    i - firstStage + 1, stages[i].pid, seconds(&usage->ru_utime), seconds(&usage->ru_stime),
+                    usage->ru_maxrss, usage->ru_minflt, usage->ru_majflt, usage->ru_nvcsw, usage->ru_nivcsw,
+                    stages[i].name);
+        }
+    }
+
+    // An outer 'time' reports these stages too
+    if (timingDepth == 0) {
+        stageCount = 0;
+    }
+    return status;
+}
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bash_func.h"
+
+
+// Trace records go to this fd, -1 while tracing is off
+static int traceFd = -1;
+static long traceCommand = 0; // Number of the traced command line
+
+
+// Function to pick the trace fd: $BASH_TRACE_FD when it names an open fd, else stderr
+static int traceTarget() {
+    const char* value = getenv("BASH_TRACE_FD");
+    if (value != NULL && value[0] != '\0') {
+        char* end;
+        long fd = strtol(value, &end, 10);
+        if (*end == '\0' && fd >= 0 && fd <= 1024 && fcntl(fd, F_GETFD) != -1) {
+            return (int)fd;
+        }
+        fprintf(stderr, "bash: BASH_TRACE_FD: %s: not an open file descriptor\n", value);
+    }
+    return STDERR_FILENO;
+}
+
+// Function to switch tracing on at startup when $BASH_TRACE_FD is set
+void initTracing() {
+    if (getenv("BASH_TRACE_FD") != NULL) {
+        traceFd = traceTarget();
+    }
+}
+
+// Function for 'set -o trace-timing' (on = 1) and 'set +o trace-timing' (on = 0)
+void setTracing(int on) {
+    traceFd = on ? traceTarget() : -1;
+}
+
+int tracingEnabled() {
+    return traceFd != -1;
+}
+
+// Function to get the trace fd, -1 while tracing is off
+int traceDescriptor() {
+    return traceFd;
+}
+
+// Function to read the monotonic clock in nanoseconds for a trace record.
+// Returns 0 while tracing is off, so untraced commands skip the clock
+long traceClock() {
+    if (traceFd == -1) {
+        return 0;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+// Function to start the records of a new command line
+void traceNextCommand() {
+    traceCommand++;
+}
+
+// Function to write one JSON line for a phase between two traceClock() readings.
+// pid: the child the phase belongs to, 0 for the shell's own work.
+// Each record is one write(), so a reader never sees half a record
+void traceSpan(const char* phase, long start, long end, pid_t pid) {
+    if (traceFd == -1) {
+        return;
+    }
+
+    char record[160];
+    int length = snprintf(record, sizeof(record),
+                          "{\"cmd\":%ld,\"phase\":\"%s\",\"pid\":%d,\"start_ns\":%ld,\"dur_ns\":%ld}\n",
+                          traceCommand, phase, (int)pid, start, end - start);
+    if (write(traceFd, record, length) == -1) {
+        traceFd = -1; // The reader went away, stop tracing
+    }
+}
+
+// Function to write the record of a phase that began at start and ends now
+void tracePhase(const char* phase, long start, pid_t pid) {
+    if (traceFd != -1) {
+        traceSpan(phase, start, traceClock(), pid);
+    }
+}